@@ -0,0 +1,181 @@
+#include "draw_info.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// construction, copy, move, packing, bounds and transform baking of the four draw info classes, every benchmark
+// reports bytes and vertices per second so runs of different mesh sizes can be compared directly
+
+namespace {
+
+constexpr std::int64_t smallest_vertex_count = 100;
+constexpr std::int64_t largest_vertex_count = 10'000'000;
+
+template <typename DrawInfo> struct ViewOf;
+template <> struct ViewOf<IndexedVertexPositions> {
+    using type = draw_info::IndexedVertexPositionsView;
+};
+template <> struct ViewOf<IVPSolidColor> {
+    using type = draw_info::IVPSolidColorView;
+};
+template <> struct ViewOf<IVPTextured> {
+    using type = draw_info::IVPTexturedView;
+};
+template <> struct ViewOf<IVPNTextured> {
+    using type = draw_info::IVPNTexturedView;
+};
+
+// the arrays every class is built from, a ribbon of triangles (i, i + 1, i + 2) over a wavy strip of vertices
+struct SourceArrays {
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> xyz_positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texture_coordinates;
+    std::vector<glm::vec3> rgb_colors;
+};
+
+SourceArrays make_source_arrays(std::size_t vertex_count) {
+    SourceArrays arrays;
+    arrays.xyz_positions.reserve(vertex_count);
+    arrays.normals.reserve(vertex_count);
+    arrays.texture_coordinates.reserve(vertex_count);
+    arrays.rgb_colors.reserve(vertex_count);
+    for (std::size_t i = 0; i < vertex_count; i++) {
+        float t = static_cast<float>(i) / static_cast<float>(vertex_count);
+        arrays.xyz_positions.emplace_back(t * 100, std::sin(t * 50), static_cast<float>(i % 2));
+        arrays.normals.emplace_back(0, 0, 1);
+        arrays.texture_coordinates.emplace_back(t, static_cast<float>(i % 2));
+        arrays.rgb_colors.emplace_back(t, 1 - t, 0.5f);
+    }
+    std::size_t triangle_count = vertex_count >= 3 ? vertex_count - 2 : 0;
+    arrays.indices.reserve(triangle_count * 3);
+    for (std::size_t i = 0; i < triangle_count; i++) {
+        arrays.indices.push_back(static_cast<unsigned int>(i));
+        arrays.indices.push_back(static_cast<unsigned int>(i + 1));
+        arrays.indices.push_back(static_cast<unsigned int>(i + 2));
+    }
+    return arrays;
+}
+
+// copies of the arrays go through the by value constructor, which is what a loader holding its own vectors does
+template <typename DrawInfo> DrawInfo construct(const SourceArrays &arrays) {
+    if constexpr (std::is_same_v<DrawInfo, IndexedVertexPositions>) {
+        return IndexedVertexPositions(arrays.indices, arrays.xyz_positions);
+    } else if constexpr (std::is_same_v<DrawInfo, IVPSolidColor>) {
+        return IVPSolidColor(arrays.indices, arrays.xyz_positions, arrays.rgb_colors);
+    } else if constexpr (std::is_same_v<DrawInfo, IVPTextured>) {
+        return IVPTextured(arrays.indices, arrays.xyz_positions, arrays.texture_coordinates, "benchmark.png");
+    } else {
+        return IVPNTextured(arrays.indices, arrays.xyz_positions, arrays.normals, arrays.texture_coordinates,
+                            "benchmark.png");
+    }
+}
+
+template <typename DrawInfo> std::size_t geometry_bytes(const DrawInfo &draw_info) {
+    std::size_t bytes =
+        draw_info.indices.size() * sizeof(unsigned int) + draw_info.xyz_positions.size() * sizeof(glm::vec3);
+    if constexpr (std::is_same_v<DrawInfo, IVPSolidColor>) {
+        bytes += draw_info.rgb_colors.size() * sizeof(glm::vec3);
+    }
+    if constexpr (std::is_same_v<DrawInfo, IVPTextured> || std::is_same_v<DrawInfo, IVPNTextured>) {
+        bytes += draw_info.texture_coordinates.size() * sizeof(glm::vec2);
+    }
+    if constexpr (std::is_same_v<DrawInfo, IVPNTextured>) {
+        bytes += draw_info.normals.size() * sizeof(glm::vec3);
+    }
+    return bytes;
+}
+
+template <typename DrawInfo> void set_counters(benchmark::State &state, const DrawInfo &draw_info, std::size_t bytes) {
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * draw_info.xyz_positions.size()));
+    state.counters["vertices"] = static_cast<double>(draw_info.xyz_positions.size());
+}
+
+template <typename DrawInfo> void construction(benchmark::State &state) {
+    SourceArrays arrays = make_source_arrays(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        DrawInfo draw_info = construct<DrawInfo>(arrays);
+        benchmark::DoNotOptimize(draw_info.xyz_positions.data());
+    }
+    DrawInfo reference = construct<DrawInfo>(arrays);
+    set_counters(state, reference, geometry_bytes(reference));
+}
+
+template <typename DrawInfo> void copy(benchmark::State &state) {
+    DrawInfo source = construct<DrawInfo>(make_source_arrays(static_cast<std::size_t>(state.range(0))));
+    for (auto _ : state) {
+        DrawInfo draw_info = source;
+        benchmark::DoNotOptimize(draw_info.xyz_positions.data());
+    }
+    set_counters(state, source, geometry_bytes(source));
+}
+
+// one iteration moves the object out and back, moves should cost the same at every size
+template <typename DrawInfo> void move(benchmark::State &state) {
+    DrawInfo source = construct<DrawInfo>(make_source_arrays(static_cast<std::size_t>(state.range(0))));
+    std::size_t bytes = geometry_bytes(source);
+    for (auto _ : state) {
+        DrawInfo moved = std::move(source);
+        benchmark::DoNotOptimize(moved.xyz_positions.data());
+        source = std::move(moved);
+    }
+    set_counters(state, source, bytes);
+}
+
+template <typename DrawInfo> void pack_vertices(benchmark::State &state) {
+    DrawInfo source = construct<DrawInfo>(make_source_arrays(static_cast<std::size_t>(state.range(0))));
+    typename ViewOf<DrawInfo>::type view(source);
+    std::vector<float> packed(source.xyz_positions.size() * draw_info::floats_per_packed_vertex(view));
+    for (auto _ : state) {
+        draw_info::pack_vertices(view, packed.data());
+        benchmark::DoNotOptimize(packed.data());
+        benchmark::ClobberMemory();
+    }
+    set_counters(state, source, packed.size() * sizeof(float));
+}
+
+template <typename DrawInfo> void compute_bounding_sphere(benchmark::State &state) {
+    DrawInfo source = construct<DrawInfo>(make_source_arrays(static_cast<std::size_t>(state.range(0))));
+    for (auto _ : state) {
+        draw_info::BoundingSphere sphere = draw_info::compute_bounding_sphere(source.xyz_positions);
+        benchmark::DoNotOptimize(sphere);
+    }
+    set_counters(state, source, source.xyz_positions.size() * sizeof(glm::vec3));
+}
+
+// the library transforms geometry by baking the transform while merging, a single source measures just that. the
+// matrix is applied to every position (and normal) whatever its value, so the default transform is fine
+template <typename DrawInfo> void transform(benchmark::State &state) {
+    using View = typename ViewOf<DrawInfo>::type;
+    DrawInfo source = construct<DrawInfo>(make_source_arrays(static_cast<std::size_t>(state.range(0))));
+    View view(source);
+    for (auto _ : state) {
+        DrawInfo transformed = draw_info::merge(draw_info::ArrayView<View>(&view, 1), true);
+        benchmark::DoNotOptimize(transformed.xyz_positions.data());
+    }
+    set_counters(state, source, geometry_bytes(source));
+}
+
+void vertex_counts(benchmark::internal::Benchmark *benchmark) {
+    benchmark->RangeMultiplier(10)->Range(smallest_vertex_count, largest_vertex_count)->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+#define DRAW_INFO_BENCHMARK_ALL_CLASSES(function)                                                                      \
+    BENCHMARK_TEMPLATE(function, IndexedVertexPositions)->Apply(vertex_counts);                                       \
+    BENCHMARK_TEMPLATE(function, IVPSolidColor)->Apply(vertex_counts);                                                \
+    BENCHMARK_TEMPLATE(function, IVPTextured)->Apply(vertex_counts);                                                  \
+    BENCHMARK_TEMPLATE(function, IVPNTextured)->Apply(vertex_counts)
+
+DRAW_INFO_BENCHMARK_ALL_CLASSES(construction);
+DRAW_INFO_BENCHMARK_ALL_CLASSES(copy);
+DRAW_INFO_BENCHMARK_ALL_CLASSES(move);
+DRAW_INFO_BENCHMARK_ALL_CLASSES(pack_vertices);
+DRAW_INFO_BENCHMARK_ALL_CLASSES(compute_bounding_sphere);
+DRAW_INFO_BENCHMARK_ALL_CLASSES(transform);
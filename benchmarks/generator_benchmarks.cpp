@@ -0,0 +1,98 @@
+#include "draw_info.hpp"
+
+#include <benchmark/benchmark.h>
+
+// meshes per second of the procedural generators over their tessellation parameter. the reused variants write into
+// the same object every iteration, which is the allocation free path the generators are built for, the fresh variants
+// start from an empty object each time to show what a first call (and the free after it) costs
+
+namespace {
+
+void report_meshes(benchmark::State &state, const IVPNTextured &mesh) {
+    state.counters["meshes_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()),
+                                                             benchmark::Counter::kIsRate);
+    state.counters["vertices"] = static_cast<double>(mesh.xyz_positions.size());
+    state.counters["triangles"] = static_cast<double>(mesh.indices.size() / 3);
+}
+
+template <typename Generate> void run_reused(benchmark::State &state, Generate generate) {
+    IVPNTextured mesh({}, {}, {}, {});
+    generate(mesh);
+    for (auto _ : state) {
+        generate(mesh);
+        benchmark::DoNotOptimize(mesh.xyz_positions.data());
+    }
+    report_meshes(state, mesh);
+}
+
+template <typename Generate> void run_fresh(benchmark::State &state, Generate generate) {
+    for (auto _ : state) {
+        IVPNTextured mesh({}, {}, {}, {});
+        generate(mesh);
+        benchmark::DoNotOptimize(mesh.xyz_positions.data());
+    }
+    IVPNTextured mesh({}, {}, {}, {});
+    generate(mesh);
+    report_meshes(state, mesh);
+}
+
+unsigned int tessellation(const benchmark::State &state) { return static_cast<unsigned int>(state.range(0)); }
+
+void box(benchmark::State &state) {
+    run_reused(state, [](IVPNTextured &mesh) { draw_info::generate_box(mesh); });
+}
+void box_fresh(benchmark::State &state) {
+    run_fresh(state, [](IVPNTextured &mesh) { draw_info::generate_box(mesh); });
+}
+
+void grid(benchmark::State &state) {
+    unsigned int segments = tessellation(state);
+    run_reused(state, [&](IVPNTextured &mesh) { draw_info::generate_grid(mesh, 1, 1, segments, segments); });
+}
+void grid_fresh(benchmark::State &state) {
+    unsigned int segments = tessellation(state);
+    run_fresh(state, [&](IVPNTextured &mesh) { draw_info::generate_grid(mesh, 1, 1, segments, segments); });
+}
+
+void uv_sphere(benchmark::State &state) {
+    unsigned int slices = tessellation(state);
+    run_reused(state, [&](IVPNTextured &mesh) { draw_info::generate_uv_sphere(mesh, 1, slices, slices / 2); });
+}
+void uv_sphere_fresh(benchmark::State &state) {
+    unsigned int slices = tessellation(state);
+    run_fresh(state, [&](IVPNTextured &mesh) { draw_info::generate_uv_sphere(mesh, 1, slices, slices / 2); });
+}
+
+void cylinder(benchmark::State &state) {
+    unsigned int slices = tessellation(state);
+    run_reused(state, [&](IVPNTextured &mesh) { draw_info::generate_cylinder(mesh, 1, 2, slices); });
+}
+void cylinder_fresh(benchmark::State &state) {
+    unsigned int slices = tessellation(state);
+    run_fresh(state, [&](IVPNTextured &mesh) { draw_info::generate_cylinder(mesh, 1, 2, slices); });
+}
+
+void capsule(benchmark::State &state) {
+    unsigned int slices = tessellation(state);
+    run_reused(state, [&](IVPNTextured &mesh) { draw_info::generate_capsule(mesh, 1, 2, slices, slices / 4); });
+}
+void capsule_fresh(benchmark::State &state) {
+    unsigned int slices = tessellation(state);
+    run_fresh(state, [&](IVPNTextured &mesh) { draw_info::generate_capsule(mesh, 1, 2, slices, slices / 4); });
+}
+
+// from the low poly props spawned in gameplay code up to hero assets
+void tessellations(benchmark::internal::Benchmark *benchmark) { benchmark->RangeMultiplier(4)->Range(8, 512); }
+
+} // namespace
+
+BENCHMARK(box);
+BENCHMARK(box_fresh);
+BENCHMARK(grid)->Apply(tessellations);
+BENCHMARK(grid_fresh)->Apply(tessellations);
+BENCHMARK(uv_sphere)->Apply(tessellations);
+BENCHMARK(uv_sphere_fresh)->Apply(tessellations);
+BENCHMARK(cylinder)->Apply(tessellations);
+BENCHMARK(cylinder_fresh)->Apply(tessellations);
+BENCHMARK(capsule)->Apply(tessellations);
+BENCHMARK(capsule_fresh)->Apply(tessellations);
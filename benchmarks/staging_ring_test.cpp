@@ -0,0 +1,141 @@
+#include "draw_info.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// headless check of StagingRing, a producer thread packs meshes while a fake consumer thread stands in for the gpu:
+// it takes slots in order, checks their fence and contents, holds each one for a while as an upload would and then
+// releases it. every failed check is printed and the exit code is non zero if there was any
+
+namespace {
+
+// the consumer thread checks too
+std::atomic<int> failures{0};
+
+void check(bool condition, const char *what) {
+    if (!condition) {
+        std::fprintf(stderr, "staging_ring_test: %s\n", what);
+        failures++;
+    }
+}
+
+template <typename Function> bool throws(Function function) {
+    try {
+        function();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+// mesh number `id` carries its id in the first position so the consumer can tell which mesh a slot holds
+IndexedVertexPositions make_mesh(unsigned int id) {
+    std::vector<glm::vec3> positions(3 + id % 5, glm::vec3(0));
+    positions[0].x = static_cast<float>(id);
+    std::vector<unsigned int> indices = {0, 1, 2};
+    return IndexedVertexPositions(indices, positions);
+}
+
+void check_misuse() {
+    check(throws([] { draw_info::StagingRing ring(0); }), "a ring without slots was accepted");
+
+    draw_info::StagingRing ring(2, 1024);
+    check(throws([&] { ring.submit(); }), "submit without try_acquire was accepted");
+    check(throws([&] { ring.release(); }), "release without try_consume was accepted");
+    check(ring.try_consume() == nullptr, "an empty ring handed out a slot");
+}
+
+// single threaded, so the exact stall count is known
+void check_stalls() {
+    draw_info::StagingRing ring(2, 1024);
+    check(ring.try_write(make_mesh(0)) && ring.try_write(make_mesh(1)), "writes into free slots failed");
+    check(!ring.try_write(make_mesh(2)), "a write into a full ring succeeded");
+    check(ring.get_stats().stalls == 1, "a full ring did not count a stall");
+    check(ring.get_completed_fence() == 0, "a fence completed before anything was released");
+
+    check(ring.try_consume() != nullptr, "a submitted slot could not be consumed");
+    check(!ring.try_write(make_mesh(2)), "a write went into a slot still being consumed");
+    ring.release();
+    check(ring.get_completed_fence() == 1, "releasing the first slot did not complete fence 1");
+    check(ring.try_write(make_mesh(2)), "a released slot was not reused");
+    check(ring.get_stats().stalls == 2, "stall count after reuse is wrong");
+
+    check(!ring.try_write(IndexedVertexPositions({}, std::vector<glm::vec3>(200))), "an oversized mesh was written");
+    check(ring.get_stats().oversized_rejections == 1, "an oversized mesh was not counted");
+}
+
+void check_producer_and_consumer() {
+    const unsigned int mesh_count = 20000;
+    draw_info::StagingRing ring(3, 1024);
+    std::size_t producer_stalls = 0;
+    std::size_t expected_bytes = 0;
+
+    std::thread producer([&] {
+        for (unsigned int id = 0; id < mesh_count; id++) {
+            IndexedVertexPositions mesh = make_mesh(id);
+            expected_bytes +=
+                mesh.xyz_positions.size() * sizeof(glm::vec3) + mesh.indices.size() * sizeof(unsigned int);
+            // the producer never blocks, a stalled write is simply retried as it would be next frame
+            while (!ring.try_write(mesh)) {
+                producer_stalls++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&] {
+        std::uint64_t expected_fence = 1;
+        for (unsigned int id = 0; id < mesh_count;) {
+            const draw_info::StagingRing::Slot *slot = ring.try_consume();
+            if (slot == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            float first_x;
+            std::memcpy(&first_x, slot->bytes.data(), sizeof(float));
+            check(slot->fence == expected_fence, "slots were consumed out of fence order");
+            check(first_x == static_cast<float>(id), "a slot held the wrong mesh");
+            check(slot->vertex_count == 3 + id % 5 && slot->index_count == 3, "a slot has the wrong counts");
+            check(ring.get_completed_fence() == expected_fence - 1, "the completed fence ran ahead of the consumer");
+            // pretend the upload takes a moment every few meshes so the producer catches up and stalls
+            if (id % 64 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            ring.release();
+            check(ring.get_completed_fence() == expected_fence, "release did not complete the slot's fence");
+            expected_fence++;
+            id++;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    draw_info::StagingRing::Stats stats = ring.get_stats();
+    check(stats.slots_submitted == mesh_count, "submitted slot count is wrong");
+    check(stats.slots_consumed == mesh_count, "consumed slot count is wrong");
+    check(stats.bytes_submitted == expected_bytes, "submitted byte count is wrong");
+    check(stats.stalls == producer_stalls, "the ring and the producer disagree on stalls");
+    check(stats.bytes_per_second() > 0, "no throughput was reported");
+    std::printf("staging_ring_test: %zu slots, %zu stalls, %.1f MB/s\n", stats.slots_submitted, stats.stalls,
+                stats.bytes_per_second() / 1e6);
+}
+
+} // namespace
+
+int main() {
+    check_misuse();
+    check_stalls();
+    check_producer_and_consumer();
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    std::printf("staging_ring_test: ok\n");
+    return EXIT_SUCCESS;
+}
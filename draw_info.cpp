@@ -1,2 +1,4406 @@
 #include "draw_info.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace draw_info {
+
+namespace {
+
+constexpr std::uint64_t prime_1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t prime_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t prime_3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t prime_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t prime_5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline std::uint64_t read_u64(const unsigned char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint32_t read_u32(const unsigned char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t xxh_round(std::uint64_t acc, std::uint64_t input) {
+    acc += input * prime_2;
+    acc = rotl(acc, 31);
+    return acc * prime_1;
+}
+
+inline std::uint64_t merge_round(std::uint64_t acc, std::uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * prime_1 + prime_4;
+}
+
+template <typename T> std::uint64_t hash_vector(ArrayView<T> v, std::uint64_t seed) {
+    // the length is mixed in so that moving bytes between consecutive arrays changes the hash
+    std::uint64_t size = v.size();
+    seed = hash_bytes(&size, sizeof(size), seed);
+    return hash_bytes(v.data(), v.size() * sizeof(T), seed);
+}
+
+template <typename T> std::size_t vector_bytes(ArrayView<T> v) { return v.size() * sizeof(T); }
+
+} // namespace
+
+namespace instrumentation {
+
+namespace {
+
+struct TraceEvent {
+    Operation operation;
+    std::uint64_t bytes;
+    std::uint64_t start_nanoseconds;
+    std::uint64_t nanoseconds;
+};
+
+// owned by the registry below rather than by the thread so that counters survive thread exit
+struct ThreadCounters {
+    unsigned int thread_index = 0;
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Operation::count)> calls{};
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Operation::count)> bytes{};
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Operation::count)> nanoseconds{};
+    std::mutex events_mutex; // only contended while exporting
+    std::vector<TraceEvent> events;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> threads;
+    std::atomic<bool> tracing_enabled{false};
+    std::atomic<std::size_t> max_events_per_thread{1 << 16};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadCounters &this_thread_counters() {
+    thread_local ThreadCounters *counters = [] {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(std::make_unique<ThreadCounters>());
+        r.threads.back()->thread_index = static_cast<unsigned int>(r.threads.size());
+        return r.threads.back().get();
+    }();
+    return *counters;
+}
+
+} // namespace
+
+const char *to_string(Operation operation) {
+    switch (operation) {
+    case Operation::construction:
+        return "construction";
+    case Operation::packing:
+        return "packing";
+    case Operation::culling:
+        return "culling";
+    case Operation::merging:
+        return "merging";
+    case Operation::validation:
+        return "validation";
+    case Operation::degenerate_removal:
+        return "degenerate_removal";
+    case Operation::overdraw_optimization:
+        return "overdraw_optimization";
+    case Operation::encoding:
+        return "encoding";
+    case Operation::decoding:
+        return "decoding";
+    case Operation::slicing:
+        return "slicing";
+    case Operation::convex_hull:
+        return "convex_hull";
+    case Operation::generation:
+        return "generation";
+    case Operation::rasterization:
+        return "rasterization";
+    case Operation::stripify:
+        return "stripify";
+    case Operation::count:
+        break;
+    }
+    return "unknown";
+}
+
+std::uint64_t now_nanoseconds() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch)
+            .count());
+}
+
+void record(Operation operation, std::uint64_t bytes, std::uint64_t start_nanoseconds, std::uint64_t nanoseconds) {
+    ThreadCounters &counters = this_thread_counters();
+    std::size_t i = static_cast<std::size_t>(operation);
+    // only this thread writes these, so a plain load and store avoids a locked read modify write. relaxed atomics
+    // just keep concurrent aggregation well defined
+    auto add = [](std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    };
+    add(counters.calls[i], 1);
+    add(counters.bytes[i], bytes);
+    add(counters.nanoseconds[i], nanoseconds);
+
+    Registry &r = registry();
+    if (nanoseconds > 0 && r.tracing_enabled.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(counters.events_mutex);
+        if (counters.events.size() < r.max_events_per_thread.load(std::memory_order_relaxed)) {
+            counters.events.push_back(TraceEvent{operation, bytes, start_nanoseconds, nanoseconds});
+        }
+    }
+}
+
+std::array<OperationCounters, static_cast<std::size_t>(Operation::count)> aggregate_counters() {
+    std::array<OperationCounters, static_cast<std::size_t>(Operation::count)> totals{};
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &thread : r.threads) {
+        for (std::size_t i = 0; i < totals.size(); i++) {
+            totals[i].calls += thread->calls[i].load(std::memory_order_relaxed);
+            totals[i].bytes += thread->bytes[i].load(std::memory_order_relaxed);
+            totals[i].nanoseconds += thread->nanoseconds[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+void reset() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &thread : r.threads) {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(Operation::count); i++) {
+            thread->calls[i].store(0, std::memory_order_relaxed);
+            thread->bytes[i].store(0, std::memory_order_relaxed);
+            thread->nanoseconds[i].store(0, std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> events_lock(thread->events_mutex);
+        thread->events.clear();
+    }
+}
+
+void set_tracing_enabled(bool enabled, std::size_t max_events_per_thread) {
+    registry().max_events_per_thread.store(max_events_per_thread, std::memory_order_relaxed);
+    registry().tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::string export_chrome_trace() {
+    std::ostringstream json;
+    // timestamps are in microseconds, three decimals keep the full nanosecond resolution where the default
+    // precision would round long runs to a few significant digits
+    json << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    bool first = true;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &thread : r.threads) {
+        std::lock_guard<std::mutex> events_lock(thread->events_mutex);
+        for (const TraceEvent &event : thread->events) {
+            json << (first ? "" : ",") << "{\"name\":\"" << to_string(event.operation)
+                 << "\",\"cat\":\"draw_info\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread->thread_index
+                 << ",\"ts\":" << event.start_nanoseconds / 1000.0 << ",\"dur\":" << event.nanoseconds / 1000.0
+                 << ",\"args\":{\"bytes\":" << event.bytes << "}}";
+            first = false;
+        }
+    }
+    json << "],\"displayTimeUnit\":\"ns\"}";
+    return json.str();
+}
+
+} // namespace instrumentation
+
+void DirtyRanges::mark(std::size_t begin, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::size_t end = begin + count;
+    // first range that could touch [begin, end)
+    auto first = std::lower_bound(ranges.begin(), ranges.end(), begin,
+                                  [](const IndexRange &range, std::size_t value) { return range.end < value; });
+    auto last = first;
+    while (last != ranges.end() && last->begin <= end) {
+        begin = std::min(begin, last->begin);
+        end = std::max(end, last->end);
+        ++last;
+    }
+    if (first == last) {
+        ranges.insert(first, IndexRange{begin, end});
+    } else {
+        *first = IndexRange{begin, end};
+        ranges.erase(first + 1, last);
+    }
+}
+
+void DirtyRanges::mark_all(std::size_t element_count) {
+    ranges.clear();
+    if (element_count > 0) {
+        ranges.push_back(IndexRange{0, element_count});
+    }
+}
+
+void DirtyRanges::coalesce(std::size_t max_gap) {
+    if (ranges.size() < 2) {
+        return;
+    }
+    std::size_t write = 0;
+    for (std::size_t read = 1; read < ranges.size(); read++) {
+        if (ranges[read].begin - ranges[write].end <= max_gap) {
+            ranges[write].end = ranges[read].end;
+        } else {
+            ranges[++write] = ranges[read];
+        }
+    }
+    ranges.resize(write + 1);
+}
+
+std::size_t DirtyRanges::dirty_element_count() const {
+    std::size_t count = 0;
+    for (const IndexRange &range : ranges) {
+        count += range.size();
+    }
+    return count;
+}
+
+std::uint64_t hash_bytes(const void *data, std::size_t size, std::uint64_t seed) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + size;
+    std::uint64_t h;
+
+    if (size >= 32) {
+        std::uint64_t v1 = seed + prime_1 + prime_2;
+        std::uint64_t v2 = seed + prime_2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - prime_1;
+        const unsigned char *limit = end - 32;
+        do {
+            v1 = xxh_round(v1, read_u64(p));
+            v2 = xxh_round(v2, read_u64(p + 8));
+            v3 = xxh_round(v3, read_u64(p + 16));
+            v4 = xxh_round(v4, read_u64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + prime_5;
+    }
+
+    h += static_cast<std::uint64_t>(size);
+
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, read_u64(p));
+        h = rotl(h, 27) * prime_1 + prime_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<std::uint64_t>(read_u32(p)) * prime_1;
+        h = rotl(h, 23) * prime_2 + prime_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<std::uint64_t>(*p) * prime_5;
+        h = rotl(h, 11) * prime_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= prime_2;
+    h ^= h >> 29;
+    h *= prime_3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::uint64_t hash_geometry(const IndexedVertexPositionsView &ivp) {
+    std::uint64_t h = hash_vector(ivp.indices, 0);
+    return hash_vector(ivp.xyz_positions, h);
+}
+
+std::uint64_t hash_geometry(const IVPSolidColorView &ivpsc) {
+    std::uint64_t h = hash_vector(ivpsc.indices, 0);
+    h = hash_vector(ivpsc.xyz_positions, h);
+    h = hash_vector(ivpsc.texture_coordinates, h);
+    return hash_vector(ivpsc.rgb_colors, h);
+}
+
+std::uint64_t hash_geometry(const IVPTexturedView &ivpt) {
+    std::uint64_t h = hash_vector(ivpt.indices, 0);
+    h = hash_vector(ivpt.xyz_positions, h);
+    return hash_vector(ivpt.texture_coordinates, h);
+}
+
+std::uint64_t hash_geometry(const IVPNTexturedView &ivpnt) {
+    std::uint64_t h = hash_vector(ivpnt.indices, 0);
+    h = hash_vector(ivpnt.xyz_positions, h);
+    h = hash_vector(ivpnt.normals, h);
+    return hash_vector(ivpnt.texture_coordinates, h);
+}
+
+// comparisons are bytewise so that they agree with the hash, this means -0.0 and 0.0 are considered different
+namespace {
+template <typename T> bool same_bytes(ArrayView<T> a, ArrayView<T> b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+} // namespace
+
+bool same_geometry(const IndexedVertexPositionsView &a, const IndexedVertexPositionsView &b) {
+    return same_bytes(a.indices, b.indices) && same_bytes(a.xyz_positions, b.xyz_positions);
+}
+
+bool same_geometry(const IVPSolidColorView &a, const IVPSolidColorView &b) {
+    return same_bytes(a.indices, b.indices) && same_bytes(a.xyz_positions, b.xyz_positions) &&
+           same_bytes(a.texture_coordinates, b.texture_coordinates) && same_bytes(a.rgb_colors, b.rgb_colors);
+}
+
+bool same_geometry(const IVPTexturedView &a, const IVPTexturedView &b) {
+    return same_bytes(a.indices, b.indices) && same_bytes(a.xyz_positions, b.xyz_positions) &&
+           same_bytes(a.texture_coordinates, b.texture_coordinates);
+}
+
+bool same_geometry(const IVPNTexturedView &a, const IVPNTexturedView &b) {
+    return same_bytes(a.indices, b.indices) && same_bytes(a.xyz_positions, b.xyz_positions) &&
+           same_bytes(a.normals, b.normals) && same_bytes(a.texture_coordinates, b.texture_coordinates);
+}
+
+std::size_t geometry_size_in_bytes(const IndexedVertexPositionsView &ivp) {
+    return vector_bytes(ivp.indices) + vector_bytes(ivp.xyz_positions);
+}
+
+std::size_t geometry_size_in_bytes(const IVPSolidColorView &ivpsc) {
+    return vector_bytes(ivpsc.indices) + vector_bytes(ivpsc.xyz_positions) +
+           vector_bytes(ivpsc.texture_coordinates) + vector_bytes(ivpsc.rgb_colors);
+}
+
+std::size_t geometry_size_in_bytes(const IVPTexturedView &ivpt) {
+    return vector_bytes(ivpt.indices) + vector_bytes(ivpt.xyz_positions) + vector_bytes(ivpt.texture_coordinates);
+}
+
+std::size_t geometry_size_in_bytes(const IVPNTexturedView &ivpnt) {
+    return vector_bytes(ivpnt.indices) + vector_bytes(ivpnt.xyz_positions) + vector_bytes(ivpnt.normals) +
+           vector_bytes(ivpnt.texture_coordinates);
+}
+
+BoundingSphere compute_bounding_sphere(ArrayView<glm::vec3> xyz_positions) {
+    BoundingSphere sphere;
+    if (xyz_positions.empty()) {
+        return sphere;
+    }
+    glm::vec3 min = xyz_positions[0];
+    glm::vec3 max = xyz_positions[0];
+    for (const glm::vec3 &p : xyz_positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    sphere.center = (min + max) * 0.5f;
+    float max_distance_squared = 0;
+    for (const glm::vec3 &p : xyz_positions) {
+        glm::vec3 d = p - sphere.center;
+        max_distance_squared = std::max(max_distance_squared, glm::dot(d, d));
+    }
+    sphere.radius = std::sqrt(max_distance_squared);
+    return sphere;
+}
+
+unsigned int InstanceArray::add_instance(const glm::mat4 &model_matrix, const glm::vec4 &color) {
+    model_matrices.push_back(model_matrix);
+    colors.push_back(color);
+    return static_cast<unsigned int>(model_matrices.size() - 1);
+}
+
+unsigned int InstanceArray::add_instance(const Transform &transform, const glm::vec4 &color) {
+    return add_instance(transform.get_transform_matrix(), color);
+}
+
+void InstanceArray::remove_instance(unsigned int instance_index) {
+    model_matrices[instance_index] = model_matrices.back();
+    colors[instance_index] = colors.back();
+    model_matrices.pop_back();
+    colors.pop_back();
+}
+
+void InstanceArray::set_model_matrix(unsigned int instance_index, const glm::mat4 &model_matrix) {
+    model_matrices[instance_index] = model_matrix;
+}
+
+void InstanceArray::set_color(unsigned int instance_index, const glm::vec4 &color) { colors[instance_index] = color; }
+
+void InstanceArray::reserve(std::size_t count) {
+    model_matrices.reserve(count);
+    colors.reserve(count);
+}
+
+void InstanceArray::clear() {
+    model_matrices.clear();
+    colors.clear();
+}
+
+void InstanceArray::cull(const BoundingSphere &local_bounds, const std::array<glm::vec4, 6> &frustum_planes,
+                         std::vector<unsigned int> &visible_instance_indices) const {
+    DRAW_INFO_PROFILE_SCOPE(culling, model_matrices.size() * sizeof(glm::mat4));
+    visible_instance_indices.clear();
+    visible_instance_indices.reserve(model_matrices.size());
+    const glm::vec4 local_center(local_bounds.center, 1);
+    for (std::size_t i = 0; i < model_matrices.size(); i++) {
+        const glm::mat4 &m = model_matrices[i];
+        glm::vec4 world_center = m * local_center;
+        // the largest axis scale bounds how much the sphere can grow
+        float scale_squared = 0;
+        for (int column = 0; column < 3; column++) {
+            scale_squared = std::max(scale_squared, m[column].x * m[column].x + m[column].y * m[column].y +
+                                                        m[column].z * m[column].z);
+        }
+        float radius = local_bounds.radius * std::sqrt(scale_squared);
+        bool inside = true;
+        for (const glm::vec4 &plane : frustum_planes) {
+            float distance = plane.x * world_center.x + plane.y * world_center.y + plane.z * world_center.z + plane.w;
+            if (distance < -radius) {
+                inside = false;
+                break;
+            }
+        }
+        if (inside) {
+            visible_instance_indices.push_back(static_cast<unsigned int>(i));
+        }
+    }
+}
+
+namespace {
+void write_instance(const glm::mat4 &m, const glm::vec4 &color, float *out) {
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            *out++ = m[column][row];
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        *out++ = color[i];
+    }
+}
+} // namespace
+
+void InstanceArray::write_instance_buffer(const std::vector<unsigned int> &instance_indices,
+                                          std::vector<float> &out) const {
+    out.resize(instance_indices.size() * floats_per_instance);
+    float *dst = out.data();
+    for (unsigned int instance_index : instance_indices) {
+        write_instance(model_matrices[instance_index], colors[instance_index], dst);
+        dst += floats_per_instance;
+    }
+}
+
+void InstanceArray::write_instance_buffer(std::vector<float> &out) const {
+    out.resize(model_matrices.size() * floats_per_instance);
+    float *dst = out.data();
+    for (std::size_t i = 0; i < model_matrices.size(); i++) {
+        write_instance(model_matrices[i], colors[i], dst);
+        dst += floats_per_instance;
+    }
+}
+
+std::size_t floats_per_packed_vertex(const IndexedVertexPositionsView &) { return 3; }
+std::size_t floats_per_packed_vertex(const IVPSolidColorView &) { return 6; }
+std::size_t floats_per_packed_vertex(const IVPTexturedView &) { return 5; }
+std::size_t floats_per_packed_vertex(const IVPNTexturedView &) { return 8; }
+
+void pack_vertices(const IndexedVertexPositionsView &ivp, float *out) {
+    DRAW_INFO_PROFILE_SCOPE(packing, ivp.xyz_positions.size() * sizeof(glm::vec3));
+    if (!ivp.xyz_positions.empty()) {
+        std::memcpy(out, ivp.xyz_positions.data(), ivp.xyz_positions.size() * sizeof(glm::vec3));
+    }
+}
+
+void pack_vertices(const IVPSolidColorView &ivpsc, float *out) {
+    DRAW_INFO_PROFILE_SCOPE(packing, ivpsc.xyz_positions.size() * 6 * sizeof(float));
+    for (std::size_t i = 0; i < ivpsc.xyz_positions.size(); i++) {
+        const glm::vec3 &p = ivpsc.xyz_positions[i];
+        const glm::vec3 &c = ivpsc.rgb_colors[i];
+        out[0] = p.x, out[1] = p.y, out[2] = p.z;
+        out[3] = c.x, out[4] = c.y, out[5] = c.z;
+        out += 6;
+    }
+}
+
+void pack_vertices(const IVPTexturedView &ivpt, float *out) {
+    DRAW_INFO_PROFILE_SCOPE(packing, ivpt.xyz_positions.size() * 5 * sizeof(float));
+    for (std::size_t i = 0; i < ivpt.xyz_positions.size(); i++) {
+        const glm::vec3 &p = ivpt.xyz_positions[i];
+        const glm::vec2 &uv = ivpt.texture_coordinates[i];
+        out[0] = p.x, out[1] = p.y, out[2] = p.z;
+        out[3] = uv.x, out[4] = uv.y;
+        out += 5;
+    }
+}
+
+void pack_vertices(const IVPNTexturedView &ivpnt, float *out) {
+    DRAW_INFO_PROFILE_SCOPE(packing, ivpnt.xyz_positions.size() * 8 * sizeof(float));
+    for (std::size_t i = 0; i < ivpnt.xyz_positions.size(); i++) {
+        const glm::vec3 &p = ivpnt.xyz_positions[i];
+        const glm::vec3 &n = ivpnt.normals[i];
+        const glm::vec2 &uv = ivpnt.texture_coordinates[i];
+        out[0] = p.x, out[1] = p.y, out[2] = p.z;
+        out[3] = n.x, out[4] = n.y, out[5] = n.z;
+        out[6] = uv.x, out[7] = uv.y;
+        out += 8;
+    }
+}
+
+StagingRing::StagingRing(std::size_t slot_count, std::size_t slot_capacity_in_bytes)
+    : slots(slot_count), slot_states(slot_count, SlotState::free), slot_capacity_in_bytes(slot_capacity_in_bytes),
+      creation_time(std::chrono::steady_clock::now()) {
+    if (slot_count == 0) {
+        throw std::runtime_error("draw_info: a staging ring needs at least one slot");
+    }
+    for (Slot &slot : slots) {
+        // storage comes from operator new so it is aligned well enough for the floats packed into it
+        slot.bytes.resize(slot_capacity_in_bytes);
+    }
+}
+
+StagingRing::Slot *StagingRing::try_acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot_states[producer_index] != SlotState::free) {
+        stats.stalls++;
+        return nullptr;
+    }
+    slot_states[producer_index] = SlotState::writing;
+    return &slots[producer_index];
+}
+
+void StagingRing::submit() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot_states[producer_index] != SlotState::writing) {
+        throw std::runtime_error("draw_info: submit without a slot from try_acquire");
+    }
+    Slot &slot = slots[producer_index];
+    slot.fence = next_fence++;
+    slot_states[producer_index] = SlotState::submitted;
+    stats.slots_submitted++;
+    stats.bytes_submitted += slot.vertex_bytes + slot.index_bytes;
+    producer_index = (producer_index + 1) % slots.size();
+}
+
+const StagingRing::Slot *StagingRing::try_consume() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot_states[consumer_index] != SlotState::submitted) {
+        return nullptr;
+    }
+    slot_states[consumer_index] = SlotState::consuming;
+    return &slots[consumer_index];
+}
+
+void StagingRing::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot_states[consumer_index] != SlotState::consuming) {
+        throw std::runtime_error("draw_info: release without a slot from try_consume");
+    }
+    completed_fence = slots[consumer_index].fence;
+    slot_states[consumer_index] = SlotState::free;
+    stats.slots_consumed++;
+    consumer_index = (consumer_index + 1) % slots.size();
+}
+
+std::uint64_t StagingRing::get_completed_fence() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return completed_fence;
+}
+
+StagingRing::Stats StagingRing::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = stats;
+    result.seconds_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - creation_time).count();
+    return result;
+}
+
+namespace {
+
+ValidationReport validate_geometry(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                                   const ValidationOptions &options) {
+    DRAW_INFO_PROFILE_SCOPE(validation,
+                            indices.size() * sizeof(unsigned int) + xyz_positions.size() * sizeof(glm::vec3));
+    ValidationReport report;
+    report.index_count_multiple_of_three = indices.size() % 3 == 0;
+
+    const unsigned int *index_data = indices.data();
+    const std::size_t index_count = indices.size();
+    const std::size_t vertex_count = xyz_positions.size();
+    // compared in 32 bits so the loop stays vectorizable, a mesh with more vertices than that accepts every index
+    const bool every_index_fits = vertex_count > std::numeric_limits<unsigned int>::max();
+    const unsigned int index_limit = every_index_fits ? 0 : static_cast<unsigned int>(vertex_count);
+
+    // no early outs so that these reductions stay vectorizable
+    unsigned int max_index = 0;
+    std::size_t out_of_range = 0;
+    for (std::size_t i = 0; i < index_count; i++) {
+        unsigned int index = index_data[i];
+        max_index = index > max_index ? index : max_index;
+        out_of_range += index >= index_limit;
+    }
+    report.max_index = max_index;
+    report.out_of_range_indices = every_index_fits ? 0 : out_of_range;
+
+    // x - x is only nan when x is inf or nan, which avoids a call to std::isfinite per component (this relies on ieee
+    // semantics, so it must not be compiled with -ffast-math)
+    const float *position_data = reinterpret_cast<const float *>(xyz_positions.data());
+    const std::size_t float_count = xyz_positions.size() * 3;
+    std::size_t non_finite_components = 0;
+    for (std::size_t i = 0; i < float_count; i++) {
+        float x = position_data[i];
+        non_finite_components += !((x - x) == 0.0f);
+    }
+    if (non_finite_components > 0) {
+        for (const glm::vec3 &p : xyz_positions) {
+            report.non_finite_positions += !(std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z));
+        }
+    }
+
+    const std::size_t triangle_count = index_count / 3;
+    std::vector<std::array<unsigned int, 3>> triangle_keys;
+    if (options.check_duplicate_triangles) {
+        triangle_keys.reserve(triangle_count);
+    }
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        unsigned int a = index_data[3 * t], b = index_data[3 * t + 1], c = index_data[3 * t + 2];
+        if (a >= vertex_count || b >= vertex_count || c >= vertex_count) {
+            continue;
+        }
+        if (a == b || b == c || a == c) {
+            report.degenerate_triangles++;
+            continue;
+        }
+        if (options.check_duplicate_triangles) {
+            // rotate so the smallest index is first, this keeps the winding so that back to back faces differ
+            if (b < a && b < c) {
+                std::swap(a, b), std::swap(b, c);
+            } else if (c < a && c < b) {
+                std::swap(a, c), std::swap(b, c);
+            }
+            triangle_keys.push_back({a, b, c});
+        }
+    }
+
+    if (options.check_duplicate_triangles && triangle_keys.size() > 1) {
+        std::sort(triangle_keys.begin(), triangle_keys.end());
+        for (std::size_t i = 1; i < triangle_keys.size(); i++) {
+            report.duplicate_triangles += triangle_keys[i] == triangle_keys[i - 1];
+        }
+    }
+    return report;
+}
+
+template <typename T> void check_attribute_size(ValidationReport &report, ArrayView<T> attribute,
+                                                std::size_t vertex_count) {
+    report.attribute_sizes_match = report.attribute_sizes_match && attribute.size() == vertex_count;
+}
+
+} // namespace
+
+ValidationReport validate(const IndexedVertexPositionsView &ivp, const ValidationOptions &options) {
+    return validate_geometry(ivp.indices, ivp.xyz_positions, options);
+}
+
+ValidationReport validate(const IVPSolidColorView &ivpsc, const ValidationOptions &options) {
+    ValidationReport report = validate_geometry(ivpsc.indices, ivpsc.xyz_positions, options);
+    check_attribute_size(report, ivpsc.rgb_colors, ivpsc.xyz_positions.size());
+    // texture coordinates are optional for solid color meshes
+    if (!ivpsc.texture_coordinates.empty()) {
+        check_attribute_size(report, ivpsc.texture_coordinates, ivpsc.xyz_positions.size());
+    }
+    return report;
+}
+
+ValidationReport validate(const IVPTexturedView &ivpt, const ValidationOptions &options) {
+    ValidationReport report = validate_geometry(ivpt.indices, ivpt.xyz_positions, options);
+    check_attribute_size(report, ivpt.texture_coordinates, ivpt.xyz_positions.size());
+    return report;
+}
+
+ValidationReport validate(const IVPNTexturedView &ivpnt, const ValidationOptions &options) {
+    ValidationReport report = validate_geometry(ivpnt.indices, ivpnt.xyz_positions, options);
+    check_attribute_size(report, ivpnt.normals, ivpnt.xyz_positions.size());
+    check_attribute_size(report, ivpnt.texture_coordinates, ivpnt.xyz_positions.size());
+    return report;
+}
+
+namespace {
+
+std::size_t strip_triangles(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &xyz_positions,
+                            float area_epsilon) {
+    DRAW_INFO_PROFILE_SCOPE(degenerate_removal, indices.size() * sizeof(unsigned int));
+    const std::size_t vertex_count = xyz_positions.size();
+    const std::size_t triangle_count = indices.size() / 3;
+    // twice the area is the length of the cross product, compare squared lengths to skip the sqrt
+    const float twice_area_epsilon_squared = 4 * area_epsilon * area_epsilon;
+    std::size_t write = 0;
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        unsigned int a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+        if (a >= vertex_count || b >= vertex_count || c >= vertex_count || a == b || b == c || a == c) {
+            continue;
+        }
+        glm::vec3 n = glm::cross(xyz_positions[b] - xyz_positions[a], xyz_positions[c] - xyz_positions[a]);
+        float twice_area_squared = glm::dot(n, n);
+        if (!(twice_area_squared > twice_area_epsilon_squared)) {
+            continue;
+        }
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+    }
+    indices.resize(write);
+    return triangle_count - write / 3;
+}
+
+constexpr unsigned int unused_vertex = std::numeric_limits<unsigned int>::max();
+
+// rewrites indices in place and returns old vertex index -> new vertex index (or unused_vertex)
+std::vector<unsigned int> build_compaction_remap(std::vector<unsigned int> &indices, std::size_t vertex_count,
+                                                 std::size_t &used_vertex_count) {
+    std::vector<unsigned int> remap(vertex_count, unused_vertex);
+    for (unsigned int index : indices) {
+        if (index >= vertex_count) {
+            throw std::runtime_error("draw_info: index out of range in vertex compaction");
+        }
+        remap[index] = 0;
+    }
+    unsigned int next = 0;
+    for (unsigned int &r : remap) {
+        if (r != unused_vertex) {
+            r = next++;
+        }
+    }
+    for (unsigned int &index : indices) {
+        index = remap[index];
+    }
+    used_vertex_count = next;
+    return remap;
+}
+
+// an empty attribute is one the object does not use (like the texture coordinates of most IVPSolidColor), any other
+// size that differs from the vertex count would leave the attribute misaligned after compaction. checked before
+// anything is modified so a throw leaves the object as it was
+template <typename T> void check_compactable(const std::vector<T> &attribute, std::size_t vertex_count) {
+    if (!attribute.empty() && attribute.size() != vertex_count) {
+        throw std::runtime_error("draw_info: attribute size does not match the vertex count");
+    }
+}
+
+// remap is monotonic for used vertices so compaction can happen in place front to back
+template <typename T> void compact_attribute(std::vector<T> &attribute, const std::vector<unsigned int> &remap,
+                                             std::size_t used_vertex_count) {
+    if (attribute.empty()) {
+        return;
+    }
+    for (std::size_t i = 0; i < remap.size(); i++) {
+        if (remap[i] != unused_vertex) {
+            attribute[remap[i]] = attribute[i];
+        }
+    }
+    attribute.resize(used_vertex_count);
+}
+
+template <typename DrawInfo> void mark_geometry_dirty(DrawInfo &draw_info) {
+    draw_info.dirty.mark(BufferKind::indices, 0, draw_info.indices.size());
+    draw_info.dirty.mark(BufferKind::xyz_positions, 0, draw_info.xyz_positions.size());
+}
+
+} // namespace
+
+std::size_t compact_unused_vertices(IndexedVertexPositions &ivp) {
+    std::size_t used;
+    auto remap = build_compaction_remap(ivp.indices, ivp.xyz_positions.size(), used);
+    std::size_t removed = ivp.xyz_positions.size() - used;
+    compact_attribute(ivp.xyz_positions, remap, used);
+    mark_geometry_dirty(ivp);
+    return removed;
+}
+
+std::size_t compact_unused_vertices(IVPSolidColor &ivpsc) {
+    check_compactable(ivpsc.texture_coordinates, ivpsc.xyz_positions.size());
+    check_compactable(ivpsc.rgb_colors, ivpsc.xyz_positions.size());
+    std::size_t used;
+    auto remap = build_compaction_remap(ivpsc.indices, ivpsc.xyz_positions.size(), used);
+    std::size_t removed = ivpsc.xyz_positions.size() - used;
+    compact_attribute(ivpsc.xyz_positions, remap, used);
+    compact_attribute(ivpsc.texture_coordinates, remap, used);
+    compact_attribute(ivpsc.rgb_colors, remap, used);
+    mark_geometry_dirty(ivpsc);
+    ivpsc.dirty.mark(BufferKind::rgb_colors, 0, ivpsc.rgb_colors.size());
+    ivpsc.dirty.mark(BufferKind::texture_coordinates, 0, ivpsc.texture_coordinates.size());
+    return removed;
+}
+
+std::size_t compact_unused_vertices(IVPTextured &ivpt) {
+    check_compactable(ivpt.texture_coordinates, ivpt.xyz_positions.size());
+    std::size_t used;
+    auto remap = build_compaction_remap(ivpt.indices, ivpt.xyz_positions.size(), used);
+    std::size_t removed = ivpt.xyz_positions.size() - used;
+    compact_attribute(ivpt.xyz_positions, remap, used);
+    compact_attribute(ivpt.texture_coordinates, remap, used);
+    mark_geometry_dirty(ivpt);
+    ivpt.dirty.mark(BufferKind::texture_coordinates, 0, ivpt.texture_coordinates.size());
+    return removed;
+}
+
+std::size_t compact_unused_vertices(IVPNTextured &ivpnt) {
+    check_compactable(ivpnt.normals, ivpnt.xyz_positions.size());
+    check_compactable(ivpnt.texture_coordinates, ivpnt.xyz_positions.size());
+    std::size_t used;
+    auto remap = build_compaction_remap(ivpnt.indices, ivpnt.xyz_positions.size(), used);
+    std::size_t removed = ivpnt.xyz_positions.size() - used;
+    compact_attribute(ivpnt.xyz_positions, remap, used);
+    compact_attribute(ivpnt.normals, remap, used);
+    compact_attribute(ivpnt.texture_coordinates, remap, used);
+    mark_geometry_dirty(ivpnt);
+    ivpnt.dirty.mark(BufferKind::normals, 0, ivpnt.normals.size());
+    ivpnt.dirty.mark(BufferKind::texture_coordinates, 0, ivpnt.texture_coordinates.size());
+    return removed;
+}
+
+std::size_t remove_degenerate_triangles(IndexedVertexPositions &ivp, float area_epsilon) {
+    std::size_t removed = strip_triangles(ivp.indices, ivp.xyz_positions, area_epsilon);
+    compact_unused_vertices(ivp);
+    return removed;
+}
+
+std::size_t remove_degenerate_triangles(IVPSolidColor &ivpsc, float area_epsilon) {
+    std::size_t removed = strip_triangles(ivpsc.indices, ivpsc.xyz_positions, area_epsilon);
+    compact_unused_vertices(ivpsc);
+    return removed;
+}
+
+std::size_t remove_degenerate_triangles(IVPTextured &ivpt, float area_epsilon) {
+    std::size_t removed = strip_triangles(ivpt.indices, ivpt.xyz_positions, area_epsilon);
+    compact_unused_vertices(ivpt);
+    return removed;
+}
+
+std::size_t remove_degenerate_triangles(IVPNTextured &ivpnt, float area_epsilon) {
+    std::size_t removed = strip_triangles(ivpnt.indices, ivpnt.xyz_positions, area_epsilon);
+    compact_unused_vertices(ivpnt);
+    return removed;
+}
+
+namespace {
+
+// fifo cache where each vertex stores the time it was inserted, which is enough to test membership in O(1)
+class FifoCacheSimulator {
+  public:
+    FifoCacheSimulator(std::size_t vertex_count, unsigned int cache_size)
+        : insertion_time(vertex_count, 0), cache_size(cache_size) {}
+
+    // returns true on a miss
+    bool access(unsigned int vertex_index) {
+        if (time - insertion_time[vertex_index] < cache_size && insertion_time[vertex_index] != 0) {
+            return false;
+        }
+        insertion_time[vertex_index] = ++time;
+        return true;
+    }
+
+  private:
+    std::vector<std::size_t> insertion_time;
+    std::size_t time = 0;
+    unsigned int cache_size;
+};
+
+} // namespace
+
+float compute_acmr(ArrayView<unsigned int> indices, std::size_t vertex_count, unsigned int cache_size) {
+    if (indices.size() < 3) {
+        return 0;
+    }
+    FifoCacheSimulator cache(vertex_count, cache_size);
+    std::size_t misses = 0;
+    for (unsigned int index : indices) {
+        misses += cache.access(index);
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+namespace {
+
+struct DepthRasterizer {
+    unsigned int resolution;
+    std::vector<float> depth;
+    std::vector<unsigned char> covered;
+    std::size_t pixels_shaded = 0;
+
+    explicit DepthRasterizer(unsigned int resolution)
+        : resolution(resolution), depth(resolution * resolution), covered(resolution * resolution) {}
+
+    void clear() {
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+        std::fill(covered.begin(), covered.end(), 0);
+    }
+
+    // vertices are already in pixel space (x, y) with depth z, both windings are drawn since culling is view dependent
+    void draw(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0) {
+            return;
+        }
+        if (area < 0) {
+            std::swap(b, c);
+            area = -area;
+        }
+        int min_x = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+        int min_y = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+        int max_x = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+        int max_y = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+        float inverse_area = 1.0f / area;
+        for (int y = min_y; y <= max_y; y++) {
+            float py = y + 0.5f;
+            for (int x = min_x; x <= max_x; x++) {
+                float px = x + 0.5f;
+                float w0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+                float w1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+                float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+                if (w0 < 0 || w1 < 0 || w2 < 0) {
+                    continue;
+                }
+                float z = (w0 * a.z + w1 * b.z + w2 * c.z) * inverse_area;
+                std::size_t pixel = static_cast<std::size_t>(y) * resolution + x;
+                covered[pixel] = 1;
+                if (z < depth[pixel]) {
+                    depth[pixel] = z;
+                    pixels_shaded++;
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+OverdrawStatistics estimate_overdraw(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                                     unsigned int resolution) {
+    OverdrawStatistics statistics;
+    if (xyz_positions.empty() || indices.size() < 3 || resolution == 0) {
+        return statistics;
+    }
+    glm::vec3 min = xyz_positions[0], max = xyz_positions[0];
+    for (const glm::vec3 &p : xyz_positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    glm::vec3 extent = max - min;
+    float scale = std::max({extent.x, extent.y, extent.z});
+    scale = scale > 0 ? (resolution - 1) / scale : 0;
+
+    DepthRasterizer rasterizer(resolution);
+    for (int axis = 0; axis < 3; axis++) {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        for (float direction : {1.0f, -1.0f}) {
+            rasterizer.clear();
+            auto to_pixel_space = [&](const glm::vec3 &p) {
+                glm::vec3 q = (p - min) * scale;
+                return glm::vec3(q[u], q[v], direction * q[axis]);
+            };
+            for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+                rasterizer.draw(to_pixel_space(xyz_positions[indices[t]]),
+                                to_pixel_space(xyz_positions[indices[t + 1]]),
+                                to_pixel_space(xyz_positions[indices[t + 2]]));
+            }
+            for (unsigned char c : rasterizer.covered) {
+                statistics.pixels_covered += c;
+            }
+        }
+    }
+    statistics.pixels_shaded = rasterizer.pixels_shaded;
+    statistics.overdraw = statistics.pixels_covered > 0 ? static_cast<float>(statistics.pixels_shaded) /
+                                                              static_cast<float>(statistics.pixels_covered)
+                                                        : 0;
+    return statistics;
+}
+
+void optimize_overdraw(std::vector<unsigned int> &indices, ArrayView<glm::vec3> xyz_positions,
+                       unsigned int cache_size) {
+    DRAW_INFO_PROFILE_SCOPE(overdraw_optimization, indices.size() * sizeof(unsigned int));
+    const std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count < 2 || xyz_positions.empty()) {
+        return;
+    }
+
+    // clusters start at triangles where all three vertices miss, cutting there costs nothing in cache efficiency
+    std::vector<std::size_t> cluster_starts;
+    FifoCacheSimulator cache(xyz_positions.size(), cache_size);
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        int misses = cache.access(indices[3 * t]) + cache.access(indices[3 * t + 1]) + cache.access(indices[3 * t + 2]);
+        if (misses == 3 || t == 0) {
+            cluster_starts.push_back(t);
+        }
+    }
+    if (cluster_starts.size() < 2) {
+        return;
+    }
+    cluster_starts.push_back(triangle_count);
+
+    glm::vec3 mesh_center(0);
+    for (const glm::vec3 &p : xyz_positions) {
+        mesh_center += p;
+    }
+    mesh_center /= static_cast<float>(xyz_positions.size());
+
+    struct Cluster {
+        std::size_t begin;
+        std::size_t end;
+        float sort_key;
+    };
+    std::vector<Cluster> clusters;
+    clusters.reserve(cluster_starts.size() - 1);
+    for (std::size_t i = 0; i + 1 < cluster_starts.size(); i++) {
+        glm::vec3 area_weighted_centroid(0), area_weighted_normal(0);
+        float total_area = 0;
+        for (std::size_t t = cluster_starts[i]; t < cluster_starts[i + 1]; t++) {
+            const glm::vec3 &a = xyz_positions[indices[3 * t]];
+            const glm::vec3 &b = xyz_positions[indices[3 * t + 1]];
+            const glm::vec3 &c = xyz_positions[indices[3 * t + 2]];
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float area = glm::length(n);
+            area_weighted_centroid += (a + b + c) * (area / 3.0f);
+            area_weighted_normal += n;
+            total_area += area;
+        }
+        float sort_key = 0;
+        float normal_length = glm::length(area_weighted_normal);
+        if (total_area > 0 && normal_length > 0) {
+            glm::vec3 centroid = area_weighted_centroid / total_area;
+            sort_key = glm::dot(centroid - mesh_center, area_weighted_normal / normal_length);
+        }
+        clusters.push_back(Cluster{cluster_starts[i], cluster_starts[i + 1], sort_key});
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster &a, const Cluster &b) { return a.sort_key > b.sort_key; });
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(indices.size());
+    for (const Cluster &cluster : clusters) {
+        reordered.insert(reordered.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+    }
+    // a trailing partial triangle is kept where it was
+    reordered.insert(reordered.end(), indices.begin() + 3 * triangle_count, indices.end());
+    indices.swap(reordered);
+}
+
+void optimize_overdraw(IndexedVertexPositions &ivp, unsigned int cache_size) {
+    optimize_overdraw(ivp.indices, ivp.xyz_positions, cache_size);
+    ivp.dirty.mark(BufferKind::indices, 0, ivp.indices.size());
+}
+
+void optimize_overdraw(IVPSolidColor &ivpsc, unsigned int cache_size) {
+    optimize_overdraw(ivpsc.indices, ivpsc.xyz_positions, cache_size);
+    ivpsc.dirty.mark(BufferKind::indices, 0, ivpsc.indices.size());
+}
+
+void optimize_overdraw(IVPTextured &ivpt, unsigned int cache_size) {
+    optimize_overdraw(ivpt.indices, ivpt.xyz_positions, cache_size);
+    ivpt.dirty.mark(BufferKind::indices, 0, ivpt.indices.size());
+}
+
+void optimize_overdraw(IVPNTextured &ivpnt, unsigned int cache_size) {
+    optimize_overdraw(ivpnt.indices, ivpnt.xyz_positions, cache_size);
+    ivpnt.dirty.mark(BufferKind::indices, 0, ivpnt.indices.size());
+}
+
+namespace {
+
+void write_varint(std::vector<unsigned char> &out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+std::uint32_t read_varint(const unsigned char *data, std::size_t size, std::size_t &offset) {
+    std::uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (offset >= size) {
+            throw std::runtime_error("draw_info: truncated varint");
+        }
+        unsigned char byte = data[offset++];
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("draw_info: malformed varint");
+}
+
+inline std::uint32_t zigzag_encode(std::int32_t v) {
+    return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+}
+inline std::int32_t zigzag_decode(std::uint32_t v) {
+    return static_cast<std::int32_t>(v >> 1) ^ -static_cast<std::int32_t>(v & 1);
+}
+
+inline unsigned char zigzag_encode_byte(unsigned char delta) {
+    return static_cast<unsigned char>((delta << 1) ^ (static_cast<signed char>(delta) >> 7));
+}
+inline unsigned char zigzag_decode_byte(unsigned char v) {
+    return static_cast<unsigned char>((v >> 1) ^ -(v & 1));
+}
+
+constexpr std::size_t vertex_block_size = 256;
+constexpr std::size_t byte_group_size = 16;
+
+} // namespace
+
+std::vector<unsigned char> encode_indices(ArrayView<unsigned int> indices) {
+    DRAW_INFO_PROFILE_SCOPE(encoding, indices.size() * sizeof(unsigned int));
+    std::vector<unsigned char> out;
+    out.reserve(indices.size() * 2 + 5);
+    write_varint(out, static_cast<std::uint32_t>(indices.size()));
+    unsigned int previous = 0;
+    for (unsigned int index : indices) {
+        write_varint(out, zigzag_encode(static_cast<std::int32_t>(index - previous)));
+        previous = index;
+    }
+    return out;
+}
+
+std::vector<unsigned int> decode_indices(const unsigned char *data, std::size_t size, std::size_t &bytes_read) {
+    DRAW_INFO_PROFILE_SCOPE(decoding, size);
+    std::size_t offset = 0;
+    std::uint32_t count = read_varint(data, size, offset);
+    // every index takes at least one byte, which bounds the allocation for corrupt counts
+    if (count > size - offset) {
+        throw std::runtime_error("draw_info: index count exceeds encoded data");
+    }
+    std::vector<unsigned int> indices(count);
+    unsigned int previous = 0;
+    for (std::uint32_t i = 0; i < count; i++) {
+        previous += static_cast<unsigned int>(zigzag_decode(read_varint(data, size, offset)));
+        indices[i] = previous;
+    }
+    bytes_read = offset;
+    return indices;
+}
+
+std::vector<unsigned char> encode_vertices(const void *vertices, std::size_t vertex_count, std::size_t vertex_size) {
+    DRAW_INFO_PROFILE_SCOPE(encoding, vertex_count * vertex_size);
+    const unsigned char *bytes = static_cast<const unsigned char *>(vertices);
+    std::vector<unsigned char> out;
+    out.reserve(vertex_count * vertex_size / 2 + 16);
+    std::vector<unsigned char> last_vertex(vertex_size, 0);
+    unsigned char deltas[vertex_block_size];
+
+    for (std::size_t block_begin = 0; block_begin < vertex_count; block_begin += vertex_block_size) {
+        std::size_t block_count = std::min(vertex_block_size, vertex_count - block_begin);
+        std::size_t group_count = (block_count + byte_group_size - 1) / byte_group_size;
+        for (std::size_t k = 0; k < vertex_size; k++) {
+            unsigned char previous = last_vertex[k];
+            for (std::size_t i = 0; i < block_count; i++) {
+                unsigned char current = bytes[(block_begin + i) * vertex_size + k];
+                deltas[i] = zigzag_encode_byte(static_cast<unsigned char>(current - previous));
+                previous = current;
+            }
+            std::fill(deltas + block_count, deltas + group_count * byte_group_size, 0);
+            last_vertex[k] = previous;
+
+            std::size_t header_offset = out.size();
+            out.resize(out.size() + (group_count + 3) / 4, 0);
+            for (std::size_t g = 0; g < group_count; g++) {
+                const unsigned char *group = deltas + g * byte_group_size;
+                unsigned char max_delta = *std::max_element(group, group + byte_group_size);
+                int mode = max_delta == 0 ? 0 : max_delta < 4 ? 1 : max_delta < 16 ? 2 : 3;
+                out[header_offset + g / 4] |= static_cast<unsigned char>(mode << ((g % 4) * 2));
+                int bits = mode == 0 ? 0 : 1 << mode;
+                if (bits == 8) {
+                    out.insert(out.end(), group, group + byte_group_size);
+                } else if (bits > 0) {
+                    int per_byte = 8 / bits;
+                    for (std::size_t i = 0; i < byte_group_size; i += per_byte) {
+                        unsigned char packed = 0;
+                        for (int j = 0; j < per_byte; j++) {
+                            packed |= static_cast<unsigned char>(group[i + j] << (j * bits));
+                        }
+                        out.push_back(packed);
+                    }
+                }
+            }
+        }
+    }
+    return out;
+}
+
+namespace {
+
+// unpacks one group of Bits wide values, the fixed trip count lets the compiler unroll it into shifts and masks
+template <int Bits> void unpack_byte_group(const unsigned char *packed, unsigned char *group) {
+#if defined(__SSE2__)
+    // value j of packed byte q lands at group[q * (8 / Bits) + j], which is what the unpack instructions interleave to
+    if constexpr (Bits == 4) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(packed));
+        __m128i mask = _mm_set1_epi8(0x0F);
+        __m128i low = _mm_and_si128(v, mask), high = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(group), _mm_unpacklo_epi8(low, high));
+        return;
+    } else if constexpr (Bits == 2) {
+        std::int32_t word;
+        std::memcpy(&word, packed, 4);
+        __m128i v = _mm_cvtsi32_si128(word);
+        __m128i mask = _mm_set1_epi8(0x03);
+        __m128i v0 = _mm_and_si128(v, mask), v1 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+        __m128i v2 = _mm_and_si128(_mm_srli_epi16(v, 4), mask), v3 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+        __m128i pairs_low = _mm_unpacklo_epi8(v0, v1), pairs_high = _mm_unpacklo_epi8(v2, v3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(group), _mm_unpacklo_epi16(pairs_low, pairs_high));
+        return;
+    }
+#endif
+    constexpr std::size_t per_byte = 8 / Bits;
+    constexpr unsigned char mask = static_cast<unsigned char>((1 << Bits) - 1);
+    for (std::size_t i = 0; i < byte_group_size; i++) {
+        group[i] = static_cast<unsigned char>((packed[i / per_byte] >> ((i % per_byte) * Bits)) & mask);
+    }
+}
+
+#if defined(__SSE2__)
+// one tile of the second decode pass, 16 vertices by bytes [k, k + width) for a width of 8 or 16. sse2 is part of
+// every x86-64 target so this needs no extra flags
+void interleave_tile_16(const unsigned char *streams, std::size_t i, std::size_t k, std::size_t width,
+                        std::size_t size, unsigned char *last_vertex, unsigned char *out) {
+    const __m128i low_bits = _mm_set1_epi8(0x7F), one = _mm_set1_epi8(1), zero = _mm_setzero_si128();
+    __m128i rows[16];
+    for (std::size_t r = 0; r < 16; r++) {
+        if (r >= width) {
+            rows[r] = zero;
+            continue;
+        }
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(streams + (k + r) * vertex_block_size + i));
+        rows[r] = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), low_bits),
+                                _mm_sub_epi8(zero, _mm_and_si128(v, one)));
+    }
+    // interleaving rows m and m + 8 four times over transposes a 16x16 byte matrix
+    for (int round = 0; round < 4; round++) {
+        __m128i next[16];
+        for (std::size_t m = 0; m < 8; m++) {
+            next[2 * m] = _mm_unpacklo_epi8(rows[m], rows[m + 8]);
+            next[2 * m + 1] = _mm_unpackhi_epi8(rows[m], rows[m + 8]);
+        }
+        std::memcpy(rows, next, sizeof(rows));
+    }
+    if (width == 16) {
+        __m128i running = _mm_loadu_si128(reinterpret_cast<const __m128i *>(last_vertex + k));
+        for (std::size_t r = 0; r < 16; r++) {
+            running = _mm_add_epi8(running, rows[r]);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (i + r) * size + k), running);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(last_vertex + k), running);
+    } else {
+        __m128i running = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(last_vertex + k));
+        for (std::size_t r = 0; r < 16; r++) {
+            running = _mm_add_epi8(running, rows[r]);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out + (i + r) * size + k), running);
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(last_vertex + k), running);
+    }
+}
+constexpr std::size_t interleave_group_size = 16;
+#else
+// __BYTE_ORDER__ is a gcc and clang builtin, windows only runs little endian so msvc needs no probe
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_WIN32)
+constexpr bool little_endian_target = true;
+#else
+constexpr bool little_endian_target = false;
+#endif
+
+// transposes an 8x8 byte matrix held as 8 little endian rows, three rounds of swapping ever larger sub blocks
+void transpose_8x8_bytes(std::uint64_t rows[8]) {
+    auto swap_blocks = [&](std::size_t a, std::size_t b, int shift, std::uint64_t mask) {
+        std::uint64_t t = ((rows[a] >> shift) ^ rows[b]) & mask;
+        rows[b] ^= t;
+        rows[a] ^= t << shift;
+    };
+    for (std::size_t r = 0; r < 8; r += 2) {
+        swap_blocks(r, r + 1, 8, 0x00FF00FF00FF00FFull);
+    }
+    for (std::size_t r : {0, 1, 4, 5}) {
+        swap_blocks(r, r + 2, 16, 0x0000FFFF0000FFFFull);
+    }
+    for (std::size_t r = 0; r < 4; r++) {
+        swap_blocks(r, r + 4, 32, 0x00000000FFFFFFFFull);
+    }
+}
+
+// adds 8 bytes to 8 bytes lane by lane, the top bit of each byte is summed separately so no carry crosses lanes
+std::uint64_t add_bytes(std::uint64_t a, std::uint64_t b) {
+    constexpr std::uint64_t low_bits = 0x7F7F7F7F7F7F7F7Full;
+    return ((a & low_bits) + (b & low_bits)) ^ ((a ^ b) & ~low_bits);
+}
+
+// zigzag_decode_byte on 8 lanes at once, (v & 1) * 0xFF cannot carry since every lane is 0 or 1
+std::uint64_t zigzag_decode_bytes(std::uint64_t v) {
+    return ((v >> 1) & 0x7F7F7F7F7F7F7F7Full) ^ ((v & 0x0101010101010101ull) * 0xFF);
+}
+
+// the portable tile, 8 vertices by bytes [k, k + 8) in 64 bit registers
+void interleave_tile_8(const unsigned char *streams, std::size_t i, std::size_t k, std::size_t size,
+                       unsigned char *last_vertex, unsigned char *out) {
+    std::uint64_t rows[8];
+    for (std::size_t r = 0; r < 8; r++) {
+        std::memcpy(&rows[r], streams + (k + r) * vertex_block_size + i, 8);
+        rows[r] = zigzag_decode_bytes(rows[r]);
+    }
+    transpose_8x8_bytes(rows);
+    std::uint64_t running;
+    std::memcpy(&running, last_vertex + k, 8);
+    for (std::size_t r = 0; r < 8; r++) {
+        running = add_bytes(running, rows[r]);
+        std::memcpy(out + (i + r) * size + k, &running, 8);
+    }
+    std::memcpy(last_vertex + k, &running, 8);
+}
+
+constexpr std::size_t interleave_group_size = 8;
+#endif
+
+/**
+ * second decode pass, streams holds the block's zigzag encoded deltas with byte k of every vertex contiguous at
+ * streams[k * vertex_block_size]. square tiles of vertices by bytes are transposed into vertex order in registers and
+ * the running sums are applied a whole tile row at a time on the way out, so every output byte is written once.
+ */
+template <std::size_t VertexSize>
+void interleave_block(const unsigned char *streams, std::size_t vertex_size, std::size_t block_count,
+                      unsigned char *last_vertex, unsigned char *out) {
+    const std::size_t size = VertexSize != 0 ? VertexSize : vertex_size;
+    std::size_t i = 0;
+    for (; i + interleave_group_size <= block_count; i += interleave_group_size) {
+        std::size_t k = 0;
+#if defined(__SSE2__)
+        for (; k + 8 <= size; k += k + 16 <= size ? 16 : 8) {
+            interleave_tile_16(streams, i, k, k + 16 <= size ? 16 : 8, size, last_vertex, out);
+        }
+#else
+        // the 64 bit tiles load rows as integers, so big endian targets take the byte loop below
+        const std::size_t wide_size = little_endian_target ? size - size % 8 : 0;
+        for (; k < wide_size; k += 8) {
+            interleave_tile_8(streams, i, k, size, last_vertex, out);
+        }
+#endif
+        for (; k < size; k++) {
+            unsigned char running = last_vertex[k];
+            for (std::size_t r = 0; r < interleave_group_size; r++) {
+                running = static_cast<unsigned char>(running +
+                                                     zigzag_decode_byte(streams[k * vertex_block_size + i + r]));
+                out[(i + r) * size + k] = running;
+            }
+            last_vertex[k] = running;
+        }
+    }
+    for (; i < block_count; i++) {
+        for (std::size_t k = 0; k < size; k++) {
+            last_vertex[k] =
+                static_cast<unsigned char>(last_vertex[k] + zigzag_decode_byte(streams[k * vertex_block_size + i]));
+            out[i * size + k] = last_vertex[k];
+        }
+    }
+}
+
+using InterleaveBlock = void (*)(const unsigned char *, std::size_t, std::size_t, unsigned char *, unsigned char *);
+
+// the common vertex layouts get a version with a constant size, everything else uses the generic loop
+InterleaveBlock select_interleave_block(std::size_t vertex_size) {
+    switch (vertex_size) {
+    case 4:
+        return interleave_block<4>;
+    case 8:
+        return interleave_block<8>;
+    case 12:
+        return interleave_block<12>;
+    case 16:
+        return interleave_block<16>;
+    case 20:
+        return interleave_block<20>;
+    case 24:
+        return interleave_block<24>;
+    case 32:
+        return interleave_block<32>;
+    default:
+        return interleave_block<0>;
+    }
+}
+
+} // namespace
+
+void decode_vertices(const unsigned char *data, std::size_t size, std::size_t &bytes_read, void *vertices,
+                     std::size_t vertex_count, std::size_t vertex_size) {
+    DRAW_INFO_PROFILE_SCOPE(decoding, vertex_count * vertex_size);
+    unsigned char *bytes = static_cast<unsigned char *>(vertices);
+    std::vector<unsigned char> last_vertex(vertex_size, 0);
+    std::vector<unsigned char> streams(vertex_size * vertex_block_size);
+    const InterleaveBlock interleave = select_interleave_block(vertex_size);
+    std::size_t offset = 0;
+
+    for (std::size_t block_begin = 0; block_begin < vertex_count; block_begin += vertex_block_size) {
+        std::size_t block_count = std::min(vertex_block_size, vertex_count - block_begin);
+        std::size_t group_count = (block_count + byte_group_size - 1) / byte_group_size;
+        // first pass, unpack every byte stream of the block into its own contiguous run
+        for (std::size_t k = 0; k < vertex_size; k++) {
+            std::size_t header_size = (group_count + 3) / 4;
+            if (offset + header_size > size) {
+                throw std::runtime_error("draw_info: truncated vertex data");
+            }
+            const unsigned char *header = data + offset;
+            offset += header_size;
+            unsigned char *stream = streams.data() + k * vertex_block_size;
+            for (std::size_t g = 0; g < group_count; g++) {
+                unsigned char *group = stream + g * byte_group_size;
+                int mode = (header[g / 4] >> ((g % 4) * 2)) & 3;
+                std::size_t group_bytes = mode == 0 ? 0 : byte_group_size * (1 << mode) / 8;
+                if (offset + group_bytes > size) {
+                    throw std::runtime_error("draw_info: truncated vertex data");
+                }
+                switch (mode) {
+                case 0:
+                    std::memset(group, 0, byte_group_size);
+                    break;
+                case 1:
+                    unpack_byte_group<2>(data + offset, group);
+                    break;
+                case 2:
+                    unpack_byte_group<4>(data + offset, group);
+                    break;
+                default:
+                    std::memcpy(group, data + offset, byte_group_size);
+                    break;
+                }
+                offset += group_bytes;
+            }
+        }
+        interleave(streams.data(), vertex_size, block_count, last_vertex.data(), bytes + block_begin * vertex_size);
+    }
+    bytes_read = offset;
+}
+
+namespace {
+
+constexpr unsigned char mesh_magic[4] = {'D', 'I', 'M', '1'};
+
+enum class MeshKind : unsigned char { indexed_vertex_positions, ivp_solid_color, ivp_textured, ivpn_textured };
+
+void write_mesh_header(std::vector<unsigned char> &out, MeshKind kind, std::size_t vertex_count,
+                       std::string_view texture) {
+    out.insert(out.end(), mesh_magic, mesh_magic + 4);
+    out.push_back(static_cast<unsigned char>(kind));
+    write_varint(out, static_cast<std::uint32_t>(vertex_count));
+    write_varint(out, static_cast<std::uint32_t>(texture.size()));
+    out.insert(out.end(), texture.begin(), texture.end());
+}
+
+template <typename T> void write_attribute(std::vector<unsigned char> &out, ArrayView<T> attribute) {
+    // empty optional attributes (texture coordinates on solid color meshes) are flagged instead of encoded
+    out.push_back(attribute.empty() ? 0 : 1);
+    if (!attribute.empty()) {
+        std::vector<unsigned char> encoded = encode_vertices(attribute.data(), attribute.size(), sizeof(T));
+        out.insert(out.end(), encoded.begin(), encoded.end());
+    }
+}
+
+class MeshReader {
+  public:
+    MeshReader(const std::vector<unsigned char> &data, MeshKind expected_kind) : data(data) {
+        if (data.size() < 5 || std::memcmp(data.data(), mesh_magic, 4) != 0) {
+            throw std::runtime_error("draw_info: not an encoded mesh");
+        }
+        if (data[4] != static_cast<unsigned char>(expected_kind)) {
+            throw std::runtime_error("draw_info: encoded mesh is a different draw info class");
+        }
+        offset = 5;
+        vertex_count = read_varint(data.data(), data.size(), offset);
+        std::uint32_t texture_size = read_varint(data.data(), data.size(), offset);
+        if (offset + texture_size > data.size()) {
+            throw std::runtime_error("draw_info: truncated texture name");
+        }
+        texture.assign(reinterpret_cast<const char *>(data.data() + offset), texture_size);
+        offset += texture_size;
+    }
+
+    std::vector<unsigned int> read_indices() {
+        std::size_t bytes_read = 0;
+        auto indices = decode_indices(data.data() + offset, data.size() - offset, bytes_read);
+        offset += bytes_read;
+        return indices;
+    }
+
+    template <typename T> std::vector<T> read_attribute() {
+        if (offset >= data.size()) {
+            throw std::runtime_error("draw_info: truncated attribute");
+        }
+        bool present = data[offset++] != 0;
+        std::vector<T> attribute;
+        if (present) {
+            // every vertex takes at least one header bit per byte, reject counts the data cannot hold
+            if (vertex_count > (data.size() - offset) * 4 * byte_group_size) {
+                throw std::runtime_error("draw_info: vertex count exceeds encoded data");
+            }
+            attribute.resize(vertex_count);
+            std::size_t bytes_read = 0;
+            decode_vertices(data.data() + offset, data.size() - offset, bytes_read, attribute.data(), vertex_count,
+                            sizeof(T));
+            offset += bytes_read;
+        }
+        return attribute;
+    }
+
+    std::uint32_t vertex_count = 0;
+    std::string texture;
+
+  private:
+    const std::vector<unsigned char> &data;
+    std::size_t offset = 0;
+};
+
+} // namespace
+
+std::vector<unsigned char> encode_mesh(const IndexedVertexPositionsView &ivp) {
+    std::vector<unsigned char> out;
+    write_mesh_header(out, MeshKind::indexed_vertex_positions, ivp.xyz_positions.size(), "");
+    std::vector<unsigned char> indices = encode_indices(ivp.indices);
+    out.insert(out.end(), indices.begin(), indices.end());
+    write_attribute(out, ivp.xyz_positions);
+    return out;
+}
+
+std::vector<unsigned char> encode_mesh(const IVPSolidColorView &ivpsc) {
+    std::vector<unsigned char> out;
+    write_mesh_header(out, MeshKind::ivp_solid_color, ivpsc.xyz_positions.size(), "");
+    std::vector<unsigned char> indices = encode_indices(ivpsc.indices);
+    out.insert(out.end(), indices.begin(), indices.end());
+    write_attribute(out, ivpsc.xyz_positions);
+    write_attribute(out, ivpsc.rgb_colors);
+    write_attribute(out, ivpsc.texture_coordinates);
+    return out;
+}
+
+std::vector<unsigned char> encode_mesh(const IVPTexturedView &ivpt) {
+    std::vector<unsigned char> out;
+    write_mesh_header(out, MeshKind::ivp_textured, ivpt.xyz_positions.size(), ivpt.texture);
+    std::vector<unsigned char> indices = encode_indices(ivpt.indices);
+    out.insert(out.end(), indices.begin(), indices.end());
+    write_attribute(out, ivpt.xyz_positions);
+    write_attribute(out, ivpt.texture_coordinates);
+    return out;
+}
+
+std::vector<unsigned char> encode_mesh(const IVPNTexturedView &ivpnt) {
+    std::vector<unsigned char> out;
+    write_mesh_header(out, MeshKind::ivpn_textured, ivpnt.xyz_positions.size(), ivpnt.texture);
+    std::vector<unsigned char> indices = encode_indices(ivpnt.indices);
+    out.insert(out.end(), indices.begin(), indices.end());
+    write_attribute(out, ivpnt.xyz_positions);
+    write_attribute(out, ivpnt.normals);
+    write_attribute(out, ivpnt.texture_coordinates);
+    return out;
+}
+
+template <> IndexedVertexPositions decode_mesh<IndexedVertexPositions>(const std::vector<unsigned char> &data) {
+    MeshReader reader(data, MeshKind::indexed_vertex_positions);
+    auto indices = reader.read_indices();
+    auto xyz_positions = reader.read_attribute<glm::vec3>();
+    return IndexedVertexPositions(std::move(indices), std::move(xyz_positions));
+}
+
+template <> IVPSolidColor decode_mesh<IVPSolidColor>(const std::vector<unsigned char> &data) {
+    MeshReader reader(data, MeshKind::ivp_solid_color);
+    auto indices = reader.read_indices();
+    auto xyz_positions = reader.read_attribute<glm::vec3>();
+    auto rgb_colors = reader.read_attribute<glm::vec3>();
+    IVPSolidColor ivpsc(std::move(indices), std::move(xyz_positions), std::move(rgb_colors));
+    ivpsc.texture_coordinates = reader.read_attribute<glm::vec2>();
+    return ivpsc;
+}
+
+template <> IVPTextured decode_mesh<IVPTextured>(const std::vector<unsigned char> &data) {
+    MeshReader reader(data, MeshKind::ivp_textured);
+    auto indices = reader.read_indices();
+    auto xyz_positions = reader.read_attribute<glm::vec3>();
+    auto texture_coordinates = reader.read_attribute<glm::vec2>();
+    return IVPTextured(std::move(indices), std::move(xyz_positions), std::move(texture_coordinates), reader.texture);
+}
+
+template <> IVPNTextured decode_mesh<IVPNTextured>(const std::vector<unsigned char> &data) {
+    MeshReader reader(data, MeshKind::ivpn_textured);
+    auto indices = reader.read_indices();
+    auto xyz_positions = reader.read_attribute<glm::vec3>();
+    auto normals = reader.read_attribute<glm::vec3>();
+    auto texture_coordinates = reader.read_attribute<glm::vec2>();
+    return IVPNTextured(std::move(indices), std::move(xyz_positions), std::move(normals),
+                        std::move(texture_coordinates), reader.texture);
+}
+
+namespace {
+
+inline std::uint32_t to_unorm(float v, float max_value) {
+    // written without branches or library calls so the loops over whole color arrays vectorize
+    v = v < 0 ? 0 : v;
+    v = v > 1 ? 1 : v;
+    return static_cast<std::uint32_t>(v * max_value + 0.5f);
+}
+
+inline std::uint32_t pack_rgba8(const glm::vec3 &c) {
+    return to_unorm(c.x, 255) | (to_unorm(c.y, 255) << 8) | (to_unorm(c.z, 255) << 16) | 0xff000000u;
+}
+
+} // namespace
+
+void pack_colors_rgba8(ArrayView<glm::vec3> rgb_colors, std::vector<std::uint32_t> &out) {
+    out.resize(rgb_colors.size());
+    const glm::vec3 *src = rgb_colors.data();
+    std::uint32_t *dst = out.data();
+    for (std::size_t i = 0; i < rgb_colors.size(); i++) {
+        dst[i] = pack_rgba8(src[i]);
+    }
+}
+
+void pack_colors_rgb565(ArrayView<glm::vec3> rgb_colors, std::vector<std::uint16_t> &out) {
+    out.resize(rgb_colors.size());
+    const glm::vec3 *src = rgb_colors.data();
+    std::uint16_t *dst = out.data();
+    for (std::size_t i = 0; i < rgb_colors.size(); i++) {
+        dst[i] = static_cast<std::uint16_t>((to_unorm(src[i].x, 31) << 11) | (to_unorm(src[i].y, 63) << 5) |
+                                            to_unorm(src[i].z, 31));
+    }
+}
+
+void unpack_colors_rgba8(const std::vector<std::uint32_t> &packed, std::vector<glm::vec3> &out) {
+    out.resize(packed.size());
+    constexpr float scale = 1.0f / 255.0f;
+    for (std::size_t i = 0; i < packed.size(); i++) {
+        std::uint32_t p = packed[i];
+        out[i] = glm::vec3((p & 0xff) * scale, ((p >> 8) & 0xff) * scale, ((p >> 16) & 0xff) * scale);
+    }
+}
+
+void unpack_colors_rgb565(const std::vector<std::uint16_t> &packed, std::vector<glm::vec3> &out) {
+    out.resize(packed.size());
+    for (std::size_t i = 0; i < packed.size(); i++) {
+        std::uint16_t p = packed[i];
+        out[i] = glm::vec3((p >> 11) * (1.0f / 31.0f), ((p >> 5) & 0x3f) * (1.0f / 63.0f), (p & 0x1f) * (1.0f / 31.0f));
+    }
+}
+
+bool has_uniform_color(ArrayView<glm::vec3> rgb_colors, glm::vec3 &uniform_color) {
+    if (rgb_colors.empty()) {
+        return false;
+    }
+    const glm::vec3 first = rgb_colors[0];
+    // counting instead of returning early keeps the loop vectorizable, the common case is scanning everything anyway
+    std::size_t differing = 0;
+    for (const glm::vec3 &c : rgb_colors) {
+        differing += (c.x != first.x) | (c.y != first.y) | (c.z != first.z);
+    }
+    if (differing != 0) {
+        return false;
+    }
+    uniform_color = first;
+    return true;
+}
+
+std::size_t PackedColors::size_in_bytes() const {
+    switch (format) {
+    case ColorFormat::uniform:
+        return sizeof(glm::vec3);
+    case ColorFormat::rgba8:
+        return rgba8.size() * sizeof(std::uint32_t);
+    case ColorFormat::rgb565:
+        return rgb565.size() * sizeof(std::uint16_t);
+    case ColorFormat::rgb32f:
+        return rgb32f.size() * sizeof(glm::vec3);
+    }
+    return 0;
+}
+
+void PackedColors::unpack(std::vector<glm::vec3> &rgb_colors, std::size_t vertex_count) const {
+    switch (format) {
+    case ColorFormat::uniform:
+        rgb_colors.assign(vertex_count, uniform_color);
+        break;
+    case ColorFormat::rgba8:
+        unpack_colors_rgba8(rgba8, rgb_colors);
+        break;
+    case ColorFormat::rgb565:
+        unpack_colors_rgb565(rgb565, rgb_colors);
+        break;
+    case ColorFormat::rgb32f:
+        rgb_colors = rgb32f;
+        break;
+    }
+}
+
+PackedColors compact_colors(const IVPSolidColorView &ivpsc, ColorFormat format) {
+    PackedColors packed;
+    if (has_uniform_color(ivpsc.rgb_colors, packed.uniform_color)) {
+        packed.format = ColorFormat::uniform;
+        return packed;
+    }
+    packed.format = format;
+    switch (format) {
+    case ColorFormat::uniform:
+        // the colors are not uniform, keep them exact rather than picking one
+        packed.format = ColorFormat::rgb32f;
+        packed.rgb32f.assign(ivpsc.rgb_colors.begin(), ivpsc.rgb_colors.end());
+        break;
+    case ColorFormat::rgba8:
+        pack_colors_rgba8(ivpsc.rgb_colors, packed.rgba8);
+        break;
+    case ColorFormat::rgb565:
+        pack_colors_rgb565(ivpsc.rgb_colors, packed.rgb565);
+        break;
+    case ColorFormat::rgb32f:
+        packed.rgb32f.assign(ivpsc.rgb_colors.begin(), ivpsc.rgb_colors.end());
+        break;
+    }
+    return packed;
+}
+
+void pack_vertices_rgba8(const IVPSolidColorView &ivpsc, void *out) {
+    unsigned char *dst = static_cast<unsigned char *>(out);
+    for (std::size_t i = 0; i < ivpsc.xyz_positions.size(); i++) {
+        std::uint32_t color = pack_rgba8(ivpsc.rgb_colors[i]);
+        std::memcpy(dst, &ivpsc.xyz_positions[i], sizeof(glm::vec3));
+        std::memcpy(dst + sizeof(glm::vec3), &color, sizeof(color));
+        dst += sizeof(glm::vec3) + sizeof(color);
+    }
+}
+
+namespace {
+
+constexpr float pi = 3.14159265358979323846f;
+
+// resizes every array of the output to the exact counts and hands out raw cursors into them
+struct PrimitiveWriter {
+    PrimitiveWriter(IVPNTextured &out, PrimitiveCounts counts) : out(out) {
+        DRAW_INFO_PROFILE_COUNT(generation, counts.index_count * sizeof(unsigned int) +
+                                                counts.vertex_count * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)));
+        out.indices.resize(counts.index_count);
+        out.xyz_positions.resize(counts.vertex_count);
+        out.normals.resize(counts.vertex_count);
+        out.texture_coordinates.resize(counts.vertex_count);
+        index = out.indices.data();
+        position = out.xyz_positions.data();
+        normal = out.normals.data();
+        texture_coordinate = out.texture_coordinates.data();
+    }
+
+    ~PrimitiveWriter() {
+        out.dirty.mark(BufferKind::indices, 0, out.indices.size());
+        out.dirty.mark(BufferKind::xyz_positions, 0, out.xyz_positions.size());
+        out.dirty.mark(BufferKind::normals, 0, out.normals.size());
+        out.dirty.mark(BufferKind::texture_coordinates, 0, out.texture_coordinates.size());
+    }
+
+    unsigned int vertex(const glm::vec3 &p, const glm::vec3 &n, const glm::vec2 &uv) {
+        *position++ = p;
+        *normal++ = n;
+        *texture_coordinate++ = uv;
+        return next_vertex++;
+    }
+
+    void triangle(unsigned int a, unsigned int b, unsigned int c) {
+        index[0] = a, index[1] = b, index[2] = c;
+        index += 3;
+    }
+
+    // a b on the first row, c d on the next, both rows running in the same direction
+    void quad(unsigned int a, unsigned int b, unsigned int c, unsigned int d) {
+        triangle(a, c, b);
+        triangle(b, c, d);
+    }
+
+    IVPNTextured &out;
+    unsigned int *index;
+    glm::vec3 *position;
+    glm::vec3 *normal;
+    glm::vec2 *texture_coordinate;
+    unsigned int next_vertex = 0;
+};
+
+struct Ring {
+    float radius;
+    float y;
+    glm::vec3 normal_direction; // normal at angle 0, rotated around y for the other slices
+    float v;
+};
+
+// surfaces of revolution from top to bottom, rings with zero radius are poles and get a single fan
+template <typename RingFunction>
+void write_rings(PrimitiveWriter &writer, unsigned int slices, unsigned int ring_count, RingFunction ring_at) {
+    unsigned int first_vertex = writer.next_vertex;
+    for (unsigned int r = 0; r < ring_count; r++) {
+        Ring ring = ring_at(r);
+        for (unsigned int s = 0; s <= slices; s++) {
+            float u = static_cast<float>(s) / slices;
+            float angle = u * 2 * pi;
+            float c = std::cos(angle), sn = std::sin(angle);
+            glm::vec3 n(ring.normal_direction.x * c, ring.normal_direction.y, -ring.normal_direction.x * sn);
+            writer.vertex(glm::vec3(ring.radius * c, ring.y, -ring.radius * sn), n, glm::vec2(u, ring.v));
+        }
+    }
+    for (unsigned int r = 0; r + 1 < ring_count; r++) {
+        bool top_is_pole = r == 0 && ring_at(r).radius == 0;
+        bool bottom_is_pole = r + 2 == ring_count && ring_at(r + 1).radius == 0;
+        for (unsigned int s = 0; s < slices; s++) {
+            unsigned int a = first_vertex + r * (slices + 1) + s;
+            unsigned int c = a + slices + 1;
+            if (top_is_pole) {
+                writer.triangle(a, c, c + 1);
+            } else if (bottom_is_pole) {
+                writer.triangle(a, c, a + 1);
+            } else {
+                writer.quad(a, a + 1, c, c + 1);
+            }
+        }
+    }
+}
+
+} // namespace
+
+PrimitiveCounts box_counts() { return {24, 36}; }
+
+PrimitiveCounts grid_counts(unsigned int segments_x, unsigned int segments_z) {
+    segments_x = std::max(segments_x, 1u);
+    segments_z = std::max(segments_z, 1u);
+    return {static_cast<std::size_t>(segments_x + 1) * (segments_z + 1),
+            static_cast<std::size_t>(segments_x) * segments_z * 6};
+}
+
+PrimitiveCounts uv_sphere_counts(unsigned int slices, unsigned int stacks) {
+    return {static_cast<std::size_t>(slices + 1) * (stacks + 1), static_cast<std::size_t>(slices) * (stacks - 1) * 6};
+}
+
+PrimitiveCounts cylinder_counts(unsigned int slices, bool capped) {
+    PrimitiveCounts counts{static_cast<std::size_t>(slices + 1) * 2, static_cast<std::size_t>(slices) * 6};
+    if (capped) {
+        counts.vertex_count += 2 * (slices + 1);
+        counts.index_count += 2 * static_cast<std::size_t>(slices) * 3;
+    }
+    return counts;
+}
+
+PrimitiveCounts capsule_counts(unsigned int slices, unsigned int stacks_per_hemisphere) {
+    // two hemispheres of stacks_per_hemisphere + 1 rings each, joined by the cylinder between the equators
+    return uv_sphere_counts(slices, 2 * stacks_per_hemisphere + 1);
+}
+
+void generate_box(IVPNTextured &out, const glm::vec3 &size) {
+    PrimitiveWriter writer(out, box_counts());
+    glm::vec3 h = size * 0.5f;
+    for (int axis = 0; axis < 3; axis++) {
+        for (float sign : {1.0f, -1.0f}) {
+            glm::vec3 n(0), u(0), v(0);
+            n[axis] = sign;
+            // u and v span the face so that cross(u, v) points along n
+            u[(axis + 1) % 3] = 1;
+            v[(axis + 2) % 3] = sign;
+            glm::vec3 center = n * h[axis];
+            glm::vec3 du = u * h[(axis + 1) % 3], dv = v * h[(axis + 2) % 3];
+            unsigned int a = writer.vertex(center - du - dv, n, glm::vec2(0, 0));
+            unsigned int b = writer.vertex(center + du - dv, n, glm::vec2(1, 0));
+            unsigned int c = writer.vertex(center + du + dv, n, glm::vec2(1, 1));
+            unsigned int d = writer.vertex(center - du + dv, n, glm::vec2(0, 1));
+            writer.triangle(a, b, c);
+            writer.triangle(a, c, d);
+        }
+    }
+}
+
+void generate_grid(IVPNTextured &out, float width, float depth, unsigned int segments_x, unsigned int segments_z) {
+    // a zero count would divide by zero below, it means a single quad along that axis like a count of one
+    segments_x = std::max(segments_x, 1u);
+    segments_z = std::max(segments_z, 1u);
+    PrimitiveWriter writer(out, grid_counts(segments_x, segments_z));
+    const glm::vec3 up(0, 1, 0);
+    for (unsigned int z = 0; z <= segments_z; z++) {
+        float v = static_cast<float>(z) / segments_z;
+        for (unsigned int x = 0; x <= segments_x; x++) {
+            float u = static_cast<float>(x) / segments_x;
+            writer.vertex(glm::vec3((u - 0.5f) * width, 0, (v - 0.5f) * depth), up, glm::vec2(u, v));
+        }
+    }
+    for (unsigned int z = 0; z < segments_z; z++) {
+        for (unsigned int x = 0; x < segments_x; x++) {
+            unsigned int a = z * (segments_x + 1) + x;
+            unsigned int c = a + segments_x + 1;
+            writer.quad(a, a + 1, c, c + 1);
+        }
+    }
+}
+
+void generate_uv_sphere(IVPNTextured &out, float radius, unsigned int slices, unsigned int stacks) {
+    PrimitiveWriter writer(out, uv_sphere_counts(slices, stacks));
+    write_rings(writer, slices, stacks + 1, [&](unsigned int r) {
+        float v = static_cast<float>(r) / stacks;
+        float polar = v * pi;
+        float sin_polar = r == 0 || r == stacks ? 0 : std::sin(polar);
+        glm::vec3 n(sin_polar, std::cos(polar), 0);
+        return Ring{radius * sin_polar, radius * n.y, n, v};
+    });
+}
+
+void generate_cylinder(IVPNTextured &out, float radius, float height, unsigned int slices, bool capped) {
+    PrimitiveWriter writer(out, cylinder_counts(slices, capped));
+    float half_height = height * 0.5f;
+    write_rings(writer, slices, 2, [&](unsigned int r) {
+        return Ring{radius, r == 0 ? half_height : -half_height, glm::vec3(1, 0, 0), static_cast<float>(r)};
+    });
+    if (!capped) {
+        return;
+    }
+    for (float sign : {1.0f, -1.0f}) {
+        glm::vec3 n(0, sign, 0);
+        unsigned int center = writer.vertex(glm::vec3(0, sign * half_height, 0), n, glm::vec2(0.5f, 0.5f));
+        for (unsigned int s = 0; s < slices; s++) {
+            float angle = static_cast<float>(s) / slices * 2 * pi;
+            float c = std::cos(angle), sn = std::sin(angle);
+            writer.vertex(glm::vec3(radius * c, sign * half_height, -radius * sn), n,
+                          glm::vec2(0.5f + 0.5f * c, 0.5f + 0.5f * sn));
+        }
+        for (unsigned int s = 0; s < slices; s++) {
+            unsigned int a = center + 1 + s, b = center + 1 + (s + 1) % slices;
+            if (sign > 0) {
+                writer.triangle(center, a, b);
+            } else {
+                writer.triangle(center, b, a);
+            }
+        }
+    }
+}
+
+void generate_capsule(IVPNTextured &out, float radius, float height, unsigned int slices,
+                      unsigned int stacks_per_hemisphere) {
+    PrimitiveWriter writer(out, capsule_counts(slices, stacks_per_hemisphere));
+    const unsigned int ring_count = 2 * stacks_per_hemisphere + 2;
+    const float half_height = height * 0.5f;
+    const float total_height = height + 2 * radius;
+    write_rings(writer, slices, ring_count, [&](unsigned int r) {
+        bool top = r <= stacks_per_hemisphere;
+        unsigned int hemisphere_ring = top ? r : r - 1;
+        float polar = static_cast<float>(hemisphere_ring) / (2 * stacks_per_hemisphere) * pi;
+        float sin_polar = r == 0 || r == ring_count - 1 ? 0 : std::sin(polar);
+        glm::vec3 n(sin_polar, std::cos(polar), 0);
+        float y = radius * n.y + (top ? half_height : -half_height);
+        return Ring{radius * sin_polar, y, n, (half_height + radius - y) / total_height};
+    });
+}
+
+namespace {
+
+struct MergeLayout {
+    std::vector<std::size_t> vertex_offsets;
+    std::vector<std::size_t> index_offsets;
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+};
+
+template <typename View> MergeLayout compute_merge_layout(ArrayView<View> sources) {
+    MergeLayout layout;
+    layout.vertex_offsets.reserve(sources.size());
+    layout.index_offsets.reserve(sources.size());
+    for (const View &source : sources) {
+        layout.vertex_offsets.push_back(layout.vertex_count);
+        layout.index_offsets.push_back(layout.index_count);
+        layout.vertex_count += source.xyz_positions.size();
+        layout.index_count += source.indices.size();
+    }
+    return layout;
+}
+
+// the other attributes scale with the vertex count, so indices and positions are enough to weigh a source
+template <typename View> std::size_t merge_source_bytes(const View &source) {
+    return source.indices.size() * sizeof(unsigned int) + source.xyz_positions.size() * sizeof(glm::vec3);
+}
+
+// sources [source_begin, source_end) copied whole, or when part_count > 1 the single source source_begin is split
+// into part_count even pieces of its vertices and indices and this task copies piece `part`
+struct MergeTask {
+    std::size_t source_begin;
+    std::size_t source_end;
+    std::size_t part;
+    std::size_t part_count;
+};
+
+// groups neighbouring small sources and splits large ones so every task copies about the same number of bytes, a
+// single huge source would otherwise leave every other worker idle
+template <typename View> std::vector<MergeTask> plan_merge_tasks(ArrayView<View> sources, const MergeLayout &layout) {
+    constexpr std::size_t min_task_bytes = 1 << 16;
+    const std::size_t total_bytes = layout.index_count * sizeof(unsigned int) + layout.vertex_count * sizeof(glm::vec3);
+    const std::size_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+    // a few tasks per worker leaves something to steal when sources transform at different speeds
+    const std::size_t task_bytes = std::max(min_task_bytes, total_bytes / (worker_count * 4));
+
+    std::vector<MergeTask> tasks;
+    std::size_t group_begin = 0, group_bytes = 0;
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        std::size_t bytes = merge_source_bytes(sources[i]);
+        if (bytes > task_bytes) {
+            if (group_begin < i) {
+                tasks.push_back({group_begin, i, 0, 1});
+            }
+            std::size_t part_count = (bytes + task_bytes - 1) / task_bytes;
+            for (std::size_t part = 0; part < part_count; part++) {
+                tasks.push_back({i, i + 1, part, part_count});
+            }
+            group_begin = i + 1;
+            group_bytes = 0;
+            continue;
+        }
+        if (group_bytes + bytes > task_bytes && group_begin < i) {
+            tasks.push_back({group_begin, i, 0, 1});
+            group_begin = i;
+            group_bytes = 0;
+        }
+        group_bytes += bytes;
+    }
+    if (group_begin < sources.size()) {
+        tasks.push_back({group_begin, sources.size(), 0, 1});
+    }
+    return tasks;
+}
+
+// copies the parts every class has, then calls copy_attributes(source, vertex_offset, begin, end, model_matrix) for
+// the rest, where [begin, end) is the range of the source's vertices the current task owns
+template <typename View, typename DrawInfo, typename CopyAttributes>
+void merge_geometry(ArrayView<View> sources, const MergeLayout &layout, DrawInfo &out, bool apply_transforms,
+                    CopyAttributes copy_attributes) {
+    DRAW_INFO_PROFILE_SCOPE(merging,
+                            layout.index_count * sizeof(unsigned int) + layout.vertex_count * sizeof(glm::vec3));
+    out.indices.resize(layout.index_count);
+    out.xyz_positions.resize(layout.vertex_count);
+
+    // every piece writes its own region of the output, so the tasks need no synchronization
+    auto copy_piece = [&](std::size_t i, std::size_t part, std::size_t part_count) {
+        const View &source = sources[i];
+        const std::size_t vertex_count = source.xyz_positions.size(), index_count = source.indices.size();
+        const std::size_t vertex_begin = vertex_count * part / part_count;
+        const std::size_t vertex_end = vertex_count * (part + 1) / part_count;
+        const std::size_t index_begin = index_count * part / part_count;
+        const std::size_t index_end = index_count * (part + 1) / part_count;
+
+        unsigned int vertex_offset = static_cast<unsigned int>(layout.vertex_offsets[i]);
+        unsigned int *dst_indices = out.indices.data() + layout.index_offsets[i];
+        for (std::size_t j = index_begin; j < index_end; j++) {
+            dst_indices[j] = source.indices[j] + vertex_offset;
+        }
+        glm::vec3 *dst_positions = out.xyz_positions.data() + vertex_offset;
+        glm::mat4 model_matrix(1);
+        // a view without a transform is already in world space
+        if (apply_transforms && source.transform != nullptr) {
+            model_matrix = source.transform->get_transform_matrix();
+            for (std::size_t j = vertex_begin; j < vertex_end; j++) {
+                glm::vec4 p = model_matrix * glm::vec4(source.xyz_positions[j], 1);
+                dst_positions[j] = glm::vec3(p.x, p.y, p.z);
+            }
+        } else {
+            std::copy(source.xyz_positions.begin() + vertex_begin, source.xyz_positions.begin() + vertex_end,
+                      dst_positions + vertex_begin);
+        }
+        copy_attributes(source, vertex_offset, vertex_begin, vertex_end, model_matrix);
+    };
+
+    std::vector<MergeTask> tasks = plan_merge_tasks(sources, layout);
+    run_work_stealing(tasks.size(), 0, [&](std::size_t t, unsigned int) {
+        const MergeTask &task = tasks[t];
+        for (std::size_t i = task.source_begin; i < task.source_end; i++) {
+            copy_piece(i, task.part, task.part_count);
+        }
+    });
+    out.dirty.mark(BufferKind::indices, 0, out.indices.size());
+    out.dirty.mark(BufferKind::xyz_positions, 0, out.xyz_positions.size());
+}
+
+// copies vertices [begin, end) of an attribute that may be missing on some sources, missing ones are filled with
+// fill_value. dst points at the source's first vertex in the output
+template <typename T>
+void copy_optional_attribute(ArrayView<T> source_attribute, std::size_t vertex_count, std::size_t begin,
+                             std::size_t end, T *dst, const T &fill_value) {
+    if (source_attribute.size() == vertex_count) {
+        std::copy(source_attribute.begin() + begin, source_attribute.begin() + end, dst + begin);
+    } else {
+        std::fill(dst + begin, dst + end, fill_value);
+    }
+}
+
+} // namespace
+
+IndexedVertexPositions merge(ArrayView<IndexedVertexPositionsView> sources, bool apply_transforms) {
+    IndexedVertexPositions out({}, {});
+    MergeLayout layout = compute_merge_layout(sources);
+    merge_geometry(sources, layout, out, apply_transforms,
+                   [](const IndexedVertexPositionsView &, unsigned int, std::size_t, std::size_t,
+                      const glm::mat4 &) {});
+    return out;
+}
+
+IVPSolidColor merge(ArrayView<IVPSolidColorView> sources, bool apply_transforms) {
+    IVPSolidColor out({}, {}, {});
+    MergeLayout layout = compute_merge_layout(sources);
+    bool any_texture_coordinates = std::any_of(sources.begin(), sources.end(), [](const IVPSolidColorView &source) {
+        return !source.texture_coordinates.empty();
+    });
+    out.rgb_colors.resize(layout.vertex_count);
+    if (any_texture_coordinates) {
+        out.texture_coordinates.resize(layout.vertex_count);
+    }
+    merge_geometry(sources, layout, out, apply_transforms,
+                   [&](const IVPSolidColorView &source, unsigned int vertex_offset, std::size_t begin,
+                       std::size_t end, const glm::mat4 &) {
+                       std::size_t n = source.xyz_positions.size();
+                       copy_optional_attribute(source.rgb_colors, n, begin, end, out.rgb_colors.data() + vertex_offset,
+                                               glm::vec3(1));
+                       if (any_texture_coordinates) {
+                           copy_optional_attribute(source.texture_coordinates, n, begin, end,
+                                                   out.texture_coordinates.data() + vertex_offset, glm::vec2(0));
+                       }
+                   });
+    out.dirty.mark(BufferKind::rgb_colors, 0, out.rgb_colors.size());
+    out.dirty.mark(BufferKind::texture_coordinates, 0, out.texture_coordinates.size());
+    return out;
+}
+
+IVPTextured merge(ArrayView<IVPTexturedView> sources, bool apply_transforms) {
+    IVPTextured out({}, {}, {}, sources.empty() ? "" : std::string(sources[0].texture));
+    MergeLayout layout = compute_merge_layout(sources);
+    out.texture_coordinates.resize(layout.vertex_count);
+    merge_geometry(sources, layout, out, apply_transforms,
+                   [&](const IVPTexturedView &source, unsigned int vertex_offset, std::size_t begin, std::size_t end,
+                       const glm::mat4 &) {
+                       copy_optional_attribute(source.texture_coordinates, source.xyz_positions.size(), begin, end,
+                                               out.texture_coordinates.data() + vertex_offset, glm::vec2(0));
+                   });
+    out.dirty.mark(BufferKind::texture_coordinates, 0, out.texture_coordinates.size());
+    return out;
+}
+
+IVPNTextured merge(ArrayView<IVPNTexturedView> sources, bool apply_transforms) {
+    IVPNTextured out({}, {}, {}, {}, sources.empty() ? "" : std::string(sources[0].texture));
+    MergeLayout layout = compute_merge_layout(sources);
+    out.normals.resize(layout.vertex_count);
+    out.texture_coordinates.resize(layout.vertex_count);
+    merge_geometry(sources, layout, out, apply_transforms,
+                   [&](const IVPNTexturedView &source, unsigned int vertex_offset, std::size_t begin, std::size_t end,
+                       const glm::mat4 &model_matrix) {
+                       std::size_t n = source.xyz_positions.size();
+                       glm::vec3 *dst_normals = out.normals.data() + vertex_offset;
+                       copy_optional_attribute(source.normals, n, begin, end, dst_normals, glm::vec3(0, 1, 0));
+                       if (apply_transforms) {
+                           // normals transform by the inverse transpose so non uniform scales keep them perpendicular
+                           glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+                           for (std::size_t j = begin; j < end; j++) {
+                               dst_normals[j] = glm::normalize(normal_matrix * dst_normals[j]);
+                           }
+                       }
+                       copy_optional_attribute(source.texture_coordinates, n, begin, end,
+                                               out.texture_coordinates.data() + vertex_offset, glm::vec2(0));
+                   });
+    out.dirty.mark(BufferKind::normals, 0, out.normals.size());
+    out.dirty.mark(BufferKind::texture_coordinates, 0, out.texture_coordinates.size());
+    return out;
+}
+
+namespace {
+
+template <typename View, typename DrawInfo> std::vector<View> make_views(const std::vector<DrawInfo> &sources) {
+    return std::vector<View>(sources.begin(), sources.end());
+}
+
+} // namespace
+
+IndexedVertexPositions merge(const std::vector<IndexedVertexPositions> &sources, bool apply_transforms) {
+    return merge(make_views<IndexedVertexPositionsView>(sources), apply_transforms);
+}
+
+IVPSolidColor merge(const std::vector<IVPSolidColor> &sources, bool apply_transforms) {
+    return merge(make_views<IVPSolidColorView>(sources), apply_transforms);
+}
+
+IVPTextured merge(const std::vector<IVPTextured> &sources, bool apply_transforms) {
+    return merge(make_views<IVPTexturedView>(sources), apply_transforms);
+}
+
+IVPNTextured merge(const std::vector<IVPNTextured> &sources, bool apply_transforms) {
+    return merge(make_views<IVPNTexturedView>(sources), apply_transforms);
+}
+
+namespace {
+
+constexpr unsigned int no_vertex = std::numeric_limits<unsigned int>::max();
+
+// one side of a slice, source vertices and cut points are copied over lazily the first time a triangle uses them
+class SlicePiece {
+  public:
+    SlicePiece(const IVPNTexturedView &source, bool enabled)
+        : out({}, {}, {}, {}, std::string(source.texture)), source(source), enabled(enabled) {
+        if (source.transform != nullptr) {
+            out.transform = *source.transform;
+        }
+        if (enabled) {
+            source_to_piece.assign(source.xyz_positions.size(), no_vertex);
+            out.indices.reserve(source.indices.size());
+            out.xyz_positions.reserve(source.xyz_positions.size());
+            out.normals.reserve(source.xyz_positions.size());
+            out.texture_coordinates.reserve(source.xyz_positions.size());
+        }
+    }
+
+    unsigned int source_vertex(unsigned int v) {
+        if (source_to_piece[v] == no_vertex) {
+            source_to_piece[v] = add_vertex(source.xyz_positions[v], source.normals[v], source.texture_coordinates[v]);
+        }
+        return source_to_piece[v];
+    }
+
+    unsigned int cut_vertex(unsigned int cut_index, const glm::vec3 &p, const glm::vec3 &n, const glm::vec2 &uv) {
+        if (cut_index >= cut_to_piece.size()) {
+            cut_to_piece.resize(cut_index + 1, no_vertex);
+        }
+        if (cut_to_piece[cut_index] == no_vertex) {
+            cut_to_piece[cut_index] = add_vertex(p, n, uv);
+        }
+        return cut_to_piece[cut_index];
+    }
+
+    void triangle(unsigned int a, unsigned int b, unsigned int c) {
+        out.indices.push_back(a);
+        out.indices.push_back(b);
+        out.indices.push_back(c);
+    }
+
+    unsigned int add_vertex(const glm::vec3 &p, const glm::vec3 &n, const glm::vec2 &uv) {
+        out.xyz_positions.push_back(p);
+        out.normals.push_back(n);
+        out.texture_coordinates.push_back(uv);
+        return static_cast<unsigned int>(out.xyz_positions.size() - 1);
+    }
+
+    IVPNTextured out;
+    IVPNTexturedView source;
+    bool enabled;
+
+  private:
+    std::vector<unsigned int> source_to_piece;
+    std::vector<unsigned int> cut_to_piece;
+};
+
+struct CutPoint {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texture_coordinate;
+};
+
+unsigned int find_root(std::vector<unsigned int> &parent, unsigned int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// fans each connected loop of cut segments around its centroid, facing along cap_normal
+void write_cap(SlicePiece &piece, const std::vector<CutPoint> &cut_points,
+               const std::vector<std::array<unsigned int, 2>> &segments, const glm::vec3 &cap_normal) {
+    if (!piece.enabled || segments.empty()) {
+        return;
+    }
+    std::vector<unsigned int> parent(cut_points.size());
+    for (unsigned int i = 0; i < parent.size(); i++) {
+        parent[i] = i;
+    }
+    // meshes with hard edges duplicate vertices per face, so the same cut point can come from several edges, welding
+    // them by position keeps each loop in one piece
+    std::vector<unsigned int> by_position(parent);
+    auto position_less = [&](unsigned int a, unsigned int b) {
+        const glm::vec3 &p = cut_points[a].position, &q = cut_points[b].position;
+        return std::tie(p.x, p.y, p.z) < std::tie(q.x, q.y, q.z);
+    };
+    std::sort(by_position.begin(), by_position.end(), position_less);
+    std::vector<unsigned int> weld(parent);
+    for (std::size_t i = 1; i < by_position.size(); i++) {
+        if (!position_less(by_position[i - 1], by_position[i])) {
+            weld[by_position[i]] = weld[by_position[i - 1]];
+        }
+    }
+    for (const auto &segment : segments) {
+        parent[find_root(parent, weld[segment[0]])] = find_root(parent, weld[segment[1]]);
+    }
+
+    std::vector<glm::vec3> centroid_sums(cut_points.size(), glm::vec3(0));
+    std::vector<unsigned int> counts(cut_points.size(), 0);
+    for (unsigned int i = 0; i < cut_points.size(); i++) {
+        if (weld[i] != i) {
+            continue;
+        }
+        unsigned int root = find_root(parent, i);
+        centroid_sums[root] += cut_points[i].position;
+        counts[root]++;
+    }
+
+    // planar texture coordinates from any basis of the plane
+    glm::vec3 helper = std::fabs(cap_normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    glm::vec3 u_axis = glm::normalize(glm::cross(helper, cap_normal));
+    glm::vec3 v_axis = glm::cross(cap_normal, u_axis);
+    auto cap_vertex = [&](const glm::vec3 &p) {
+        return piece.add_vertex(p, cap_normal, glm::vec2(glm::dot(p, u_axis), glm::dot(p, v_axis)));
+    };
+
+    std::vector<unsigned int> cap_vertices(cut_points.size(), no_vertex);
+    std::vector<unsigned int> centroid_vertices(cut_points.size(), no_vertex);
+    for (const auto &segment : segments) {
+        unsigned int root = find_root(parent, weld[segment[0]]);
+        if (centroid_vertices[root] == no_vertex) {
+            centroid_vertices[root] = cap_vertex(centroid_sums[root] / static_cast<float>(counts[root]));
+        }
+        for (unsigned int end : segment) {
+            if (cap_vertices[weld[end]] == no_vertex) {
+                cap_vertices[weld[end]] = cap_vertex(cut_points[end].position);
+            }
+        }
+        unsigned int c = centroid_vertices[root];
+        unsigned int a = cap_vertices[weld[segment[0]]], b = cap_vertices[weld[segment[1]]];
+        if (a == b) {
+            continue;
+        }
+        const std::vector<glm::vec3> &p = piece.out.xyz_positions;
+        if (glm::dot(glm::cross(p[a] - p[c], p[b] - p[c]), cap_normal) >= 0) {
+            piece.triangle(c, a, b);
+        } else {
+            piece.triangle(c, b, a);
+        }
+    }
+}
+
+// vertices closer to the plane than this fraction of the farthest vertex count as lying on it
+constexpr float slice_plane_epsilon = 1e-5f;
+
+std::uint64_t slice_edge_key(unsigned int a, unsigned int b) {
+    if (a > b) {
+        std::swap(a, b);
+    }
+    return (static_cast<std::uint64_t>(a) << 32) | b;
+}
+
+SliceResult slice_into(const IVPNTexturedView &ivpnt, const glm::vec4 &plane, bool cap, bool keep_below) {
+    DRAW_INFO_PROFILE_SCOPE(slicing, geometry_size_in_bytes(ivpnt));
+    const glm::vec3 plane_normal(plane.x, plane.y, plane.z);
+    const std::size_t vertex_count = ivpnt.xyz_positions.size();
+
+    std::vector<float> distances(vertex_count);
+    float max_distance = 0;
+    for (std::size_t i = 0; i < vertex_count; i++) {
+        distances[i] = glm::dot(plane_normal, ivpnt.xyz_positions[i]) + plane.w;
+        max_distance = std::max(max_distance, std::fabs(distances[i]));
+    }
+    // 1 above, -1 below, 0 on the plane, vertices on the plane are never split and belong to both sides
+    const float epsilon = max_distance * slice_plane_epsilon;
+    std::vector<signed char> sides(vertex_count);
+    for (std::size_t i = 0; i < vertex_count; i++) {
+        sides[i] = distances[i] > epsilon ? 1 : distances[i] < -epsilon ? -1 : 0;
+    }
+
+    struct TriangleSides {
+        unsigned int v[3];
+        signed char side[3];
+        int above = 0, below = 0, on = 0;
+    };
+    auto classify = [&](std::size_t t) {
+        TriangleSides triangle{{ivpnt.indices[t], ivpnt.indices[t + 1], ivpnt.indices[t + 2]}, {}};
+        for (int i = 0; i < 3; i++) {
+            triangle.side[i] = sides[triangle.v[i]];
+            triangle.above += triangle.side[i] > 0;
+            triangle.below += triangle.side[i] < 0;
+            triangle.on += triangle.side[i] == 0;
+        }
+        return triangle;
+    };
+    // an edge lying in the plane bounds the cut, taking it only from the triangle above stops it being added twice
+    auto has_cut_edge_in_plane = [&](const TriangleSides &triangle) {
+        return cap && triangle.on == 2 && triangle.above == 1;
+    };
+
+    // first pass, collect every crossed edge and every on plane vertex the cut passes through, sorted so lookups are
+    // a binary search and the cut points can be stored contiguously. an on plane vertex v is keyed as the edge (v, v)
+    std::vector<std::uint64_t> cut_keys;
+    for (std::size_t t = 0; t + 2 < ivpnt.indices.size(); t += 3) {
+        TriangleSides triangle = classify(t);
+        bool crosses = triangle.above > 0 && triangle.below > 0;
+        if (!crosses && !has_cut_edge_in_plane(triangle)) {
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            unsigned int a = triangle.v[i], b = triangle.v[(i + 1) % 3];
+            if (triangle.side[i] == 0) {
+                cut_keys.push_back(slice_edge_key(a, a));
+            } else if (crosses && triangle.side[i] == -triangle.side[(i + 1) % 3]) {
+                cut_keys.push_back(slice_edge_key(a, b));
+            }
+        }
+    }
+    std::sort(cut_keys.begin(), cut_keys.end());
+    cut_keys.erase(std::unique(cut_keys.begin(), cut_keys.end()), cut_keys.end());
+    auto cut_index = [&](unsigned int a, unsigned int b) {
+        return static_cast<unsigned int>(std::lower_bound(cut_keys.begin(), cut_keys.end(), slice_edge_key(a, b)) -
+                                         cut_keys.begin());
+    };
+
+    // interpolated from the lexicographically lower endpoint so edges duplicated across hard edges agree exactly
+    std::vector<CutPoint> cut_points(cut_keys.size());
+    for (std::size_t i = 0; i < cut_keys.size(); i++) {
+        auto a = static_cast<unsigned int>(cut_keys[i] >> 32), b = static_cast<unsigned int>(cut_keys[i]);
+        if (a == b) {
+            cut_points[i] = {ivpnt.xyz_positions[a], ivpnt.normals[a], ivpnt.texture_coordinates[a]};
+            continue;
+        }
+        const glm::vec3 &pa = ivpnt.xyz_positions[a], &pb = ivpnt.xyz_positions[b];
+        if (std::tie(pb.x, pb.y, pb.z) < std::tie(pa.x, pa.y, pa.z)) {
+            std::swap(a, b);
+        }
+        float t = distances[a] / (distances[a] - distances[b]);
+        glm::vec3 normal = glm::mix(ivpnt.normals[a], ivpnt.normals[b], t);
+        float normal_length = glm::length(normal);
+        cut_points[i] = {glm::mix(ivpnt.xyz_positions[a], ivpnt.xyz_positions[b], t),
+                         normal_length > 0 ? normal / normal_length : normal,
+                         glm::mix(ivpnt.texture_coordinates[a], ivpnt.texture_coordinates[b], t)};
+    }
+
+    SlicePiece above(ivpnt, true);
+    SlicePiece below(ivpnt, keep_below);
+    std::vector<std::array<unsigned int, 2>> segments;
+
+    auto piece_of = [&](signed char side) -> SlicePiece & { return side > 0 ? above : below; };
+    auto piece_cut_vertex = [&](SlicePiece &piece, unsigned int cut) {
+        const CutPoint &cp = cut_points[cut];
+        return piece.cut_vertex(cut, cp.position, cp.normal, cp.texture_coordinate);
+    };
+
+    for (std::size_t t = 0; t + 2 < ivpnt.indices.size(); t += 3) {
+        TriangleSides triangle = classify(t);
+        const unsigned int *v = triangle.v;
+
+        if (triangle.above == 0 || triangle.below == 0) {
+            SlicePiece *piece = triangle.above > 0 ? &above : &below;
+            if (triangle.on == 3) {
+                // lying in the plane, it closes the piece it faces away from
+                const glm::vec3 &p0 = ivpnt.xyz_positions[v[0]];
+                glm::vec3 face_normal =
+                    glm::cross(ivpnt.xyz_positions[v[1]] - p0, ivpnt.xyz_positions[v[2]] - p0);
+                piece = glm::dot(face_normal, plane_normal) > 0 ? &below : &above;
+            }
+            if (piece->enabled) {
+                piece->triangle(piece->source_vertex(v[0]), piece->source_vertex(v[1]), piece->source_vertex(v[2]));
+            }
+            if (has_cut_edge_in_plane(triangle)) {
+                int off = triangle.side[0] != 0 ? 0 : triangle.side[1] != 0 ? 1 : 2;
+                unsigned int a = v[(off + 1) % 3], b = v[(off + 2) % 3];
+                segments.push_back({cut_index(a, a), cut_index(b, b)});
+            }
+            continue;
+        }
+
+        if (triangle.on == 1) {
+            // the plane runs through one corner, only the opposite edge is split
+            int z = triangle.side[0] == 0 ? 0 : triangle.side[1] == 0 ? 1 : 2;
+            unsigned int o = v[z], m = v[(z + 1) % 3], n = v[(z + 2) % 3];
+            unsigned int c = cut_index(m, n);
+            SlicePiece &m_piece = piece_of(triangle.side[(z + 1) % 3]);
+            SlicePiece &n_piece = piece_of(triangle.side[(z + 2) % 3]);
+            if (m_piece.enabled) {
+                m_piece.triangle(m_piece.source_vertex(o), m_piece.source_vertex(m), piece_cut_vertex(m_piece, c));
+            }
+            if (n_piece.enabled) {
+                n_piece.triangle(n_piece.source_vertex(o), piece_cut_vertex(n_piece, c), n_piece.source_vertex(n));
+            }
+            if (cap) {
+                segments.push_back({cut_index(o, o), c});
+            }
+            continue;
+        }
+
+        // rotate (keeping the winding) so the vertex alone on its side comes first
+        signed char lone_side = triangle.above == 1 ? 1 : -1;
+        int lone = triangle.side[0] == lone_side ? 0 : triangle.side[1] == lone_side ? 1 : 2;
+        unsigned int l = v[lone], m = v[(lone + 1) % 3], n = v[(lone + 2) % 3];
+        unsigned int p = cut_index(l, m), q = cut_index(l, n);
+
+        SlicePiece &lone_piece = piece_of(lone_side);
+        SlicePiece &pair_piece = piece_of(static_cast<signed char>(-lone_side));
+        if (lone_piece.enabled) {
+            lone_piece.triangle(lone_piece.source_vertex(l), piece_cut_vertex(lone_piece, p),
+                                piece_cut_vertex(lone_piece, q));
+        }
+        if (pair_piece.enabled) {
+            unsigned int pp = piece_cut_vertex(pair_piece, p), pq = piece_cut_vertex(pair_piece, q);
+            unsigned int pm = pair_piece.source_vertex(m), pn = pair_piece.source_vertex(n);
+            pair_piece.triangle(pp, pm, pn);
+            pair_piece.triangle(pp, pn, pq);
+        }
+        if (cap) {
+            segments.push_back({p, q});
+        }
+    }
+
+    if (cap) {
+        glm::vec3 unit_normal = glm::normalize(plane_normal);
+        write_cap(above, cut_points, segments, -unit_normal);
+        write_cap(below, cut_points, segments, unit_normal);
+    }
+    return SliceResult{std::move(above.out), std::move(below.out)};
+}
+
+} // namespace
+
+SliceResult slice(const IVPNTexturedView &ivpnt, const glm::vec4 &plane, bool cap) {
+    return slice_into(ivpnt, plane, cap, true);
+}
+
+IVPNTextured clip(const IVPNTexturedView &ivpnt, const glm::vec4 &plane, bool cap) {
+    return std::move(slice_into(ivpnt, plane, cap, false).above);
+}
+
+namespace {
+
+class QuickHull {
+  public:
+    QuickHull(ArrayView<glm::vec3> points, unsigned int max_vertices)
+        : points(points), max_vertices(max_vertices) {}
+
+    IndexedVertexPositions build() {
+        DRAW_INFO_PROFILE_SCOPE(convex_hull, points.size() * sizeof(glm::vec3));
+        IndexedVertexPositions hull({}, {});
+        if (points.size() < 4 || !build_initial_tetrahedron()) {
+            return hull;
+        }
+        while (max_vertices == 0 || hull_vertex_count < max_vertices) {
+            // faces are queued whenever they are handed outside points, entries whose face has since been replaced
+            // (or recycled without points) are skipped
+            while (next_pending < pending.size() && (!faces[pending[next_pending]].alive ||
+                                                     faces[pending[next_pending]].outside_points.empty())) {
+                next_pending++;
+            }
+            if (next_pending == pending.size()) {
+                break;
+            }
+            unsigned int face = pending[next_pending];
+            add_point(face, farthest_outside_point(faces[face]));
+        }
+        return extract(hull);
+    }
+
+  private:
+    struct Face {
+        unsigned int v[3];
+        // the face across the edge from v[e] to v[(e + 1) % 3]
+        unsigned int neighbours[3];
+        glm::vec3 normal;
+        float offset;
+        std::vector<unsigned int> outside_points;
+        bool alive = true;
+        // add_point call that last reached this face, so the visible set search never enqueues it twice
+        unsigned int visited = 0;
+    };
+
+    float distance(const Face &face, const glm::vec3 &p) const { return glm::dot(face.normal, p) - face.offset; }
+
+    struct HorizonEdge {
+        unsigned int a, b;
+        // the face behind the edge that stays on the hull
+        unsigned int face;
+    };
+
+    // reuses the slot of a face removed by an earlier add_point so faces stays proportional to the hull size
+    unsigned int add_face(unsigned int a, unsigned int b, unsigned int c) {
+        unsigned int index;
+        if (free_faces.empty()) {
+            index = static_cast<unsigned int>(faces.size());
+            faces.emplace_back();
+        } else {
+            index = free_faces.back();
+            free_faces.pop_back();
+        }
+        Face &face = faces[index];
+        face.v[0] = a, face.v[1] = b, face.v[2] = c;
+        glm::vec3 n = glm::cross(points[b] - points[a], points[c] - points[a]);
+        float length = glm::length(n);
+        face.normal = length > 0 ? n / length : n;
+        face.offset = glm::dot(face.normal, points[a]);
+        face.outside_points.clear();
+        face.alive = true;
+        return index;
+    }
+
+    // points face's edge b -> a back at the face across it
+    void link_back(unsigned int face, unsigned int a, unsigned int b, unsigned int across) {
+        Face &f = faces[face];
+        for (int e = 0; e < 3; e++) {
+            if (f.v[e] == b && f.v[(e + 1) % 3] == a) {
+                f.neighbours[e] = across;
+            }
+        }
+    }
+
+    bool build_initial_tetrahedron() {
+        glm::vec3 min = points[0], max = points[0];
+        for (const glm::vec3 &p : points) {
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+        glm::vec3 magnitude = glm::max(glm::abs(min), glm::abs(max));
+        epsilon = 3 * std::numeric_limits<float>::epsilon() * (magnitude.x + magnitude.y + magnitude.z);
+
+        // the two extreme points along the axis with the largest spread
+        unsigned int extremes[6] = {0, 0, 0, 0, 0, 0};
+        for (unsigned int i = 0; i < points.size(); i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (points[i][axis] < points[extremes[2 * axis]][axis]) {
+                    extremes[2 * axis] = i;
+                }
+                if (points[i][axis] > points[extremes[2 * axis + 1]][axis]) {
+                    extremes[2 * axis + 1] = i;
+                }
+            }
+        }
+        unsigned int a = 0, b = 0;
+        float best = -1;
+        for (int axis = 0; axis < 3; axis++) {
+            float spread = points[extremes[2 * axis + 1]][axis] - points[extremes[2 * axis]][axis];
+            if (spread > best) {
+                best = spread, a = extremes[2 * axis], b = extremes[2 * axis + 1];
+            }
+        }
+        if (best <= epsilon) {
+            return false;
+        }
+
+        // farthest from the line ab
+        glm::vec3 ab = glm::normalize(points[b] - points[a]);
+        unsigned int c = 0;
+        best = 0;
+        for (unsigned int i = 0; i < points.size(); i++) {
+            glm::vec3 ap = points[i] - points[a];
+            glm::vec3 off_line = ap - ab * glm::dot(ap, ab);
+            float d = glm::dot(off_line, off_line);
+            if (d > best) {
+                best = d, c = i;
+            }
+        }
+        if (std::sqrt(best) <= epsilon) {
+            return false;
+        }
+
+        // farthest from the plane abc
+        glm::vec3 n = glm::normalize(glm::cross(points[b] - points[a], points[c] - points[a]));
+        unsigned int d = 0;
+        best = 0;
+        for (unsigned int i = 0; i < points.size(); i++) {
+            float dist = std::fabs(glm::dot(n, points[i] - points[a]));
+            if (dist > best) {
+                best = dist, d = i;
+            }
+        }
+        if (best <= epsilon) {
+            return false;
+        }
+
+        // orient the base so that d lies behind it
+        if (glm::dot(n, points[d] - points[a]) > 0) {
+            std::swap(b, c);
+        }
+        new_faces.clear();
+        new_faces.push_back(add_face(a, b, c));
+        new_faces.push_back(add_face(a, d, b));
+        new_faces.push_back(add_face(b, d, c));
+        new_faces.push_back(add_face(c, d, a));
+        for (unsigned int f : new_faces) {
+            for (int e = 0; e < 3; e++) {
+                for (unsigned int g : new_faces) {
+                    link_back(g, faces[f].v[e], faces[f].v[(e + 1) % 3], f);
+                }
+            }
+        }
+        hull_vertex_count = 4;
+        cone_face_from.assign(points.size(), 0);
+
+        for (unsigned int i = 0; i < points.size(); i++) {
+            if (i == a || i == b || i == c || i == d) {
+                continue;
+            }
+            assign_to_new_face(i);
+        }
+        return true;
+    }
+
+    // points inside every new face are inside the hull for good and are dropped
+    void assign_to_new_face(unsigned int point) {
+        for (unsigned int f : new_faces) {
+            if (distance(faces[f], points[point]) > epsilon) {
+                if (faces[f].outside_points.empty()) {
+                    pending.push_back(f);
+                }
+                faces[f].outside_points.push_back(point);
+                return;
+            }
+        }
+    }
+
+    unsigned int farthest_outside_point(const Face &face) const {
+        unsigned int farthest = face.outside_points[0];
+        float best = distance(face, points[farthest]);
+        for (unsigned int point : face.outside_points) {
+            float d = distance(face, points[point]);
+            if (d > best) {
+                best = d, farthest = point;
+            }
+        }
+        return farthest;
+    }
+
+    // eye lies outside start_face, the faces it sees form a connected patch around start_face so they are found by a
+    // breadth first search across neighbours instead of testing every face of the hull. a face counts as visible as
+    // soon as the eye is in front of it, with epsilon here an eye within epsilon of a nearly coplanar neighbour would
+    // fold a new face back over it
+    void add_point(unsigned int start_face, unsigned int eye) {
+        const glm::vec3 &p = points[eye];
+        search_stamp++;
+        visible.clear();
+        horizon.clear();
+        visible.push_back(start_face);
+        faces[start_face].visited = search_stamp;
+        for (std::size_t i = 0; i < visible.size(); i++) {
+            const Face &face = faces[visible[i]];
+            for (int e = 0; e < 3; e++) {
+                unsigned int across = face.neighbours[e];
+                Face &neighbour = faces[across];
+                if (neighbour.visited == search_stamp) {
+                    continue;
+                }
+                if (distance(neighbour, p) > 0) {
+                    neighbour.visited = search_stamp;
+                    visible.push_back(across);
+                } else {
+                    // the horizon is every edge of a visible face whose neighbour across it stays on the hull
+                    horizon.push_back({face.v[e], face.v[(e + 1) % 3], across});
+                }
+            }
+        }
+
+        orphans.clear();
+        for (unsigned int f : visible) {
+            Face &face = faces[f];
+            for (unsigned int point : face.outside_points) {
+                if (point != eye) {
+                    orphans.push_back(point);
+                }
+            }
+            face.outside_points.clear();
+            face.alive = false;
+            free_faces.push_back(f);
+        }
+
+        // the horizon is a loop, so each of its vertices starts exactly one new face, which is how the new faces find
+        // each other
+        new_faces.clear();
+        for (const HorizonEdge &edge : horizon) {
+            unsigned int f = add_face(edge.a, edge.b, eye);
+            faces[f].neighbours[0] = edge.face;
+            link_back(edge.face, edge.a, edge.b, f);
+            cone_face_from[edge.a] = f;
+            new_faces.push_back(f);
+        }
+        for (unsigned int f : new_faces) {
+            unsigned int next = cone_face_from[faces[f].v[1]];
+            faces[f].neighbours[1] = next;
+            faces[next].neighbours[2] = f;
+        }
+        hull_vertex_count++;
+
+        for (unsigned int point : orphans) {
+            assign_to_new_face(point);
+        }
+    }
+
+    IndexedVertexPositions &extract(IndexedVertexPositions &hull) const {
+        std::vector<unsigned int> remap(points.size(), no_vertex);
+        for (const Face &face : faces) {
+            if (!face.alive) {
+                continue;
+            }
+            for (unsigned int v : face.v) {
+                if (remap[v] == no_vertex) {
+                    remap[v] = static_cast<unsigned int>(hull.xyz_positions.size());
+                    hull.xyz_positions.push_back(points[v]);
+                }
+                hull.indices.push_back(remap[v]);
+            }
+        }
+        return hull;
+    }
+
+    ArrayView<glm::vec3> points;
+    unsigned int max_vertices;
+    unsigned int hull_vertex_count = 0;
+    unsigned int search_stamp = 0;
+    float epsilon = 0;
+    std::vector<Face> faces;
+    std::vector<unsigned int> free_faces;
+    // faces that were given outside points, processed in order
+    std::vector<unsigned int> pending;
+    std::size_t next_pending = 0;
+    std::vector<unsigned int> visible;
+    std::vector<HorizonEdge> horizon;
+    std::vector<unsigned int> new_faces;
+    std::vector<unsigned int> orphans;
+    // per hull vertex, the new face whose horizon edge starts there
+    std::vector<unsigned int> cone_face_from;
+};
+
+} // namespace
+
+IndexedVertexPositions compute_convex_hull(ArrayView<glm::vec3> xyz_positions, unsigned int max_vertices) {
+    return QuickHull(xyz_positions, max_vertices).build();
+}
+
+IndexedVertexPositions compute_convex_hull(const IndexedVertexPositionsView &ivp, unsigned int max_vertices) {
+    IndexedVertexPositions hull = compute_convex_hull(ivp.xyz_positions, max_vertices);
+    if (ivp.transform != nullptr) {
+        hull.transform = *ivp.transform;
+    }
+    return hull;
+}
+
+std::vector<IndexedVertexPositions> compute_convex_hulls(ArrayView<IndexedVertexPositionsView> meshes,
+                                                         unsigned int max_vertices) {
+    std::vector<IndexedVertexPositions> hulls(meshes.size(), IndexedVertexPositions({}, {}));
+    // hull costs vary a lot with the point count, stealing evens them out
+    run_work_stealing(meshes.size(), 0,
+                      [&](std::size_t i, unsigned int) { hulls[i] = compute_convex_hull(meshes[i], max_vertices); });
+    return hulls;
+}
+
+std::vector<IndexedVertexPositions> compute_convex_hulls(const std::vector<IndexedVertexPositions> &meshes,
+                                                         unsigned int max_vertices) {
+    return compute_convex_hulls(make_views<IndexedVertexPositionsView>(meshes), max_vertices);
+}
+
+namespace {
+
+// counting sort of (bucket, item) pairs into contiguous per bucket ranges
+void build_buckets(const std::vector<std::uint32_t> &item_buckets, const std::vector<unsigned int> &item_ids,
+                   std::size_t bucket_count, std::vector<unsigned int> &starts, std::vector<unsigned int> &items) {
+    starts.assign(bucket_count + 1, 0);
+    for (std::uint32_t bucket : item_buckets) {
+        starts[bucket + 1]++;
+    }
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        starts[i + 1] += starts[i];
+    }
+    items.resize(item_buckets.size());
+    std::vector<unsigned int> cursor(starts.begin(), starts.end() - 1);
+    for (std::size_t i = 0; i < item_buckets.size(); i++) {
+        items[cursor[item_buckets[i]]++] = item_ids[i];
+    }
+}
+
+// whether the box of cells [lo, hi] holds more than limit cells, spans fit in 32 bits and the product is checked after
+// every axis so it cannot overflow
+bool cell_count_exceeds(const glm::ivec3 &lo, const glm::ivec3 &hi, std::uint64_t limit) {
+    std::uint64_t cell_count = 1;
+    for (int axis = 0; axis < 3; axis++) {
+        cell_count *= static_cast<std::uint64_t>(static_cast<std::int64_t>(hi[axis]) - lo[axis] + 1);
+        if (cell_count > limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// a triangle covering more cells than this is kept in a separate list that triangle queries always test, one large
+// triangle over a fine grid would otherwise add an entry for every cell it covers
+constexpr std::uint64_t max_cells_per_triangle = 64;
+
+std::size_t next_power_of_two(std::size_t v) {
+    std::size_t p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace
+
+SpatialGrid::SpatialGrid(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions, float cell_size)
+    : xyz_positions(xyz_positions.begin(), xyz_positions.end()), indices(indices.begin(), indices.end()) {
+    glm::vec3 min(0), max(0);
+    if (!xyz_positions.empty()) {
+        min = max = xyz_positions[0];
+        for (const glm::vec3 &p : xyz_positions) {
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+    }
+    // an empty grid gets inverted bounds so every query misses it
+    bounds_min = xyz_positions.empty() ? glm::vec3(std::numeric_limits<float>::max()) : min;
+    bounds_max = xyz_positions.empty() ? glm::vec3(std::numeric_limits<float>::lowest()) : max;
+    if (cell_size <= 0) {
+        glm::vec3 extent = max - min;
+        float volume = std::max(extent.x, 1e-6f) * std::max(extent.y, 1e-6f) * std::max(extent.z, 1e-6f);
+        cell_size = std::cbrt(volume * 2 / std::max<std::size_t>(1, xyz_positions.size()));
+        // flat meshes would get tiny cells from the clamped axis, never go below a fraction of the largest extent
+        cell_size = std::max(cell_size, std::max({extent.x, extent.y, extent.z}) / 1024.0f);
+        cell_size = cell_size > 0 ? cell_size : 1;
+    }
+    this->cell_size = cell_size;
+    inverse_cell_size = 1.0f / cell_size;
+    table_size = next_power_of_two(std::max<std::size_t>(64, xyz_positions.size()));
+
+    std::vector<std::uint32_t> buckets(xyz_positions.size());
+    std::vector<unsigned int> ids(xyz_positions.size());
+    for (unsigned int i = 0; i < xyz_positions.size(); i++) {
+        glm::ivec3 c = cell_of(xyz_positions[i]);
+        buckets[i] = static_cast<std::uint32_t>(cell_hash(c.x, c.y, c.z));
+        ids[i] = i;
+    }
+    build_buckets(buckets, ids, table_size, vertex_cell_starts, vertex_items);
+
+    // triangles are inserted into every cell their bounding box touches, cell_of clamps so the spans stay in range
+    buckets.clear();
+    ids.clear();
+    const std::size_t triangle_count = indices.size() / 3;
+    for (unsigned int t = 0; t < triangle_count; t++) {
+        const glm::vec3 &a = xyz_positions[indices[3 * t]];
+        const glm::vec3 &b = xyz_positions[indices[3 * t + 1]];
+        const glm::vec3 &c = xyz_positions[indices[3 * t + 2]];
+        glm::ivec3 lo = cell_of(glm::min(a, glm::min(b, c)));
+        glm::ivec3 hi = cell_of(glm::max(a, glm::max(b, c)));
+        if (cell_count_exceeds(lo, hi, max_cells_per_triangle)) {
+            oversized_triangles.push_back(t);
+            continue;
+        }
+        for (int z = lo.z; z <= hi.z; z++) {
+            for (int y = lo.y; y <= hi.y; y++) {
+                for (int x = lo.x; x <= hi.x; x++) {
+                    buckets.push_back(static_cast<std::uint32_t>(cell_hash(x, y, z)));
+                    ids.push_back(t);
+                }
+            }
+        }
+    }
+    build_buckets(buckets, ids, table_size, triangle_cell_starts, triangle_items);
+    triangle_query_stamps.assign(triangle_count, 0);
+    vertex_query_stamps.assign(xyz_positions.size(), 0);
+}
+
+std::uint32_t SpatialGrid::next_query_stamp() const {
+    if (++query_stamp == 0) {
+        std::fill(vertex_query_stamps.begin(), vertex_query_stamps.end(), 0);
+        std::fill(triangle_query_stamps.begin(), triangle_query_stamps.end(), 0);
+        query_stamp = 1;
+    }
+    return query_stamp;
+}
+
+std::size_t SpatialGrid::cell_hash(int x, int y, int z) const {
+    std::uint32_t h = static_cast<std::uint32_t>(x) * 73856093u ^ static_cast<std::uint32_t>(y) * 19349663u ^
+                      static_cast<std::uint32_t>(z) * 83492791u;
+    return h & (table_size - 1);
+}
+
+int SpatialGrid::cell_coordinate(float v) const {
+    // clamped while still a float, casting a coordinate that does not fit (or nan) to int is undefined. the limit is
+    // far past any cell a real mesh reaches and leaves room to compute spans without overflow
+    constexpr float limit = 1 << 30;
+    float c = std::floor(v * inverse_cell_size);
+    if (!(c > -limit)) {
+        return -(1 << 30);
+    }
+    return c < limit ? static_cast<int>(c) : 1 << 30;
+}
+
+glm::ivec3 SpatialGrid::cell_of(const glm::vec3 &p) const {
+    return glm::ivec3(cell_coordinate(p.x), cell_coordinate(p.y), cell_coordinate(p.z));
+}
+
+template <typename Visit>
+void SpatialGrid::for_each_cell_item(const std::vector<unsigned int> &cell_starts,
+                                     const std::vector<unsigned int> &items, const glm::vec3 &min,
+                                     const glm::vec3 &max, Visit visit) const {
+    // nothing lies outside the vertex bounds (triangles included), so huge or infinite queries only cover the mesh
+    glm::vec3 query_min = glm::max(min, bounds_min), query_max = glm::min(max, bounds_max);
+    if (query_min.x > query_max.x || query_min.y > query_max.y || query_min.z > query_max.z) {
+        return;
+    }
+    glm::ivec3 lo = cell_of(query_min), hi = cell_of(query_max);
+    // a query box covering more cells than the table has buckets would visit buckets repeatedly, scan them once
+    if (cell_count_exceeds(lo, hi, table_size - 1)) {
+        for (unsigned int item : items) {
+            visit(item);
+        }
+        return;
+    }
+    for (int z = lo.z; z <= hi.z; z++) {
+        for (int y = lo.y; y <= hi.y; y++) {
+            for (int x = lo.x; x <= hi.x; x++) {
+                std::size_t h = cell_hash(x, y, z);
+                for (unsigned int i = cell_starts[h]; i < cell_starts[h + 1]; i++) {
+                    visit(items[i]);
+                }
+            }
+        }
+    }
+}
+
+bool SpatialGrid::find_nearest_vertex(const glm::vec3 &point, float max_distance, unsigned int &vertex_index) const {
+    float best = max_distance * max_distance;
+    bool found = false;
+    glm::vec3 r(max_distance);
+    // distinct cells can share a hash bucket, so the distance test also filters out vertices from other cells
+    for_each_cell_item(vertex_cell_starts, vertex_items, point - r, point + r, [&](unsigned int v) {
+        glm::vec3 d = xyz_positions[v] - point;
+        float distance_squared = glm::dot(d, d);
+        if (distance_squared < best || (distance_squared == best && (!found || v < vertex_index))) {
+            best = distance_squared;
+            vertex_index = v;
+            found = true;
+        }
+    });
+    return found;
+}
+
+void SpatialGrid::find_vertices_in_radius(const glm::vec3 &center, float radius, std::vector<unsigned int> &out) const {
+    out.clear();
+    glm::vec3 r(radius);
+    float radius_squared = radius * radius;
+    std::uint32_t stamp = next_query_stamp();
+    for_each_cell_item(vertex_cell_starts, vertex_items, center - r, center + r, [&](unsigned int v) {
+        glm::vec3 d = xyz_positions[v] - center;
+        if (vertex_query_stamps[v] != stamp && glm::dot(d, d) <= radius_squared) {
+            vertex_query_stamps[v] = stamp;
+            out.push_back(v);
+        }
+    });
+}
+
+void SpatialGrid::find_vertices_in_box(const glm::vec3 &min, const glm::vec3 &max,
+                                       std::vector<unsigned int> &out) const {
+    out.clear();
+    std::uint32_t stamp = next_query_stamp();
+    for_each_cell_item(vertex_cell_starts, vertex_items, min, max, [&](unsigned int v) {
+        const glm::vec3 &p = xyz_positions[v];
+        if (vertex_query_stamps[v] != stamp && p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x &&
+            p.y <= max.y && p.z <= max.z) {
+            vertex_query_stamps[v] = stamp;
+            out.push_back(v);
+        }
+    });
+}
+
+void SpatialGrid::find_triangles_in_box(const glm::vec3 &min, const glm::vec3 &max,
+                                        std::vector<unsigned int> &out) const {
+    out.clear();
+    std::uint32_t stamp = next_query_stamp();
+    auto test = [&](unsigned int t) {
+        if (triangle_query_stamps[t] == stamp) {
+            return;
+        }
+        triangle_query_stamps[t] = stamp;
+        const glm::vec3 &a = xyz_positions[indices[3 * t]];
+        const glm::vec3 &b = xyz_positions[indices[3 * t + 1]];
+        const glm::vec3 &c = xyz_positions[indices[3 * t + 2]];
+        glm::vec3 lo = glm::min(a, glm::min(b, c)), hi = glm::max(a, glm::max(b, c));
+        if (lo.x <= max.x && lo.y <= max.y && lo.z <= max.z && hi.x >= min.x && hi.y >= min.y && hi.z >= min.z) {
+            out.push_back(t);
+        }
+    };
+    for_each_cell_item(triangle_cell_starts, triangle_items, min, max, test);
+    for (unsigned int t : oversized_triangles) {
+        test(t);
+    }
+}
+
+std::size_t MemoryFootprint::used_bytes() const {
+    std::size_t total = object_bytes + texture_heap_bytes + dirty_tracker.used_bytes;
+    for (const AttributeFootprint &attribute : attributes) {
+        total += attribute.used_bytes;
+    }
+    return total;
+}
+
+std::size_t MemoryFootprint::reserved_bytes() const {
+    std::size_t total = object_bytes + texture_heap_bytes + dirty_tracker.reserved_bytes;
+    for (const AttributeFootprint &attribute : attributes) {
+        total += attribute.reserved_bytes;
+    }
+    return total;
+}
+
+MemoryFootprint &MemoryFootprint::operator+=(const MemoryFootprint &other) {
+    object_count += other.object_count;
+    object_bytes += other.object_bytes;
+    for (std::size_t i = 0; i < attributes.size(); i++) {
+        attributes[i].used_bytes += other.attributes[i].used_bytes;
+        attributes[i].reserved_bytes += other.attributes[i].reserved_bytes;
+    }
+    index_width_waste_bytes += other.index_width_waste_bytes;
+    texture_heap_bytes += other.texture_heap_bytes;
+    dirty_tracker.used_bytes += other.dirty_tracker.used_bytes;
+    dirty_tracker.reserved_bytes += other.dirty_tracker.reserved_bytes;
+    return *this;
+}
+
+namespace {
+
+template <typename T> void account(MemoryFootprint &footprint, BufferKind kind, const std::vector<T> &attribute) {
+    AttributeFootprint &entry = footprint.attributes[static_cast<std::size_t>(kind)];
+    entry.used_bytes += attribute.size() * sizeof(T);
+    entry.reserved_bytes += attribute.capacity() * sizeof(T);
+}
+
+template <typename DrawInfo> MemoryFootprint geometry_footprint(const DrawInfo &draw_info) {
+    MemoryFootprint footprint;
+    footprint.object_count = 1;
+    footprint.object_bytes = sizeof(DrawInfo);
+    account(footprint, BufferKind::indices, draw_info.indices);
+    account(footprint, BufferKind::xyz_positions, draw_info.xyz_positions);
+    unsigned int max_index = 0;
+    for (unsigned int index : draw_info.indices) {
+        max_index = std::max(max_index, index);
+    }
+    std::size_t needed_width = max_index <= 0xff ? 1 : max_index <= 0xffff ? 2 : sizeof(unsigned int);
+    footprint.index_width_waste_bytes = (sizeof(unsigned int) - needed_width) * draw_info.indices.size();
+    footprint.dirty_tracker.used_bytes = draw_info.dirty.used_heap_bytes();
+    footprint.dirty_tracker.reserved_bytes = draw_info.dirty.reserved_heap_bytes();
+    return footprint;
+}
+
+std::size_t string_heap_bytes(const std::string &s) {
+    // a default constructed string's capacity is the small string buffer size
+    static const std::size_t small_string_capacity = std::string().capacity();
+    return s.capacity() > small_string_capacity ? s.capacity() + 1 : 0;
+}
+
+} // namespace
+
+MemoryFootprint compute_footprint(const IndexedVertexPositions &ivp) { return geometry_footprint(ivp); }
+
+MemoryFootprint compute_footprint(const IVPSolidColor &ivpsc) {
+    MemoryFootprint footprint = geometry_footprint(ivpsc);
+    account(footprint, BufferKind::texture_coordinates, ivpsc.texture_coordinates);
+    account(footprint, BufferKind::rgb_colors, ivpsc.rgb_colors);
+    return footprint;
+}
+
+MemoryFootprint compute_footprint(const IVPTextured &ivpt) {
+    MemoryFootprint footprint = geometry_footprint(ivpt);
+    account(footprint, BufferKind::texture_coordinates, ivpt.texture_coordinates);
+    footprint.texture_heap_bytes = string_heap_bytes(ivpt.texture);
+    return footprint;
+}
+
+MemoryFootprint compute_footprint(const IVPNTextured &ivpnt) {
+    MemoryFootprint footprint = geometry_footprint(ivpnt);
+    account(footprint, BufferKind::normals, ivpnt.normals);
+    account(footprint, BufferKind::texture_coordinates, ivpnt.texture_coordinates);
+    footprint.texture_heap_bytes = string_heap_bytes(ivpnt.texture);
+    return footprint;
+}
+
+void shrink_to_fit(IndexedVertexPositions &ivp) {
+    ivp.indices.shrink_to_fit();
+    ivp.xyz_positions.shrink_to_fit();
+    ivp.dirty.shrink_to_fit();
+}
+
+void shrink_to_fit(IVPSolidColor &ivpsc) {
+    ivpsc.indices.shrink_to_fit();
+    ivpsc.xyz_positions.shrink_to_fit();
+    ivpsc.texture_coordinates.shrink_to_fit();
+    ivpsc.rgb_colors.shrink_to_fit();
+    ivpsc.dirty.shrink_to_fit();
+}
+
+void shrink_to_fit(IVPTextured &ivpt) {
+    ivpt.indices.shrink_to_fit();
+    ivpt.xyz_positions.shrink_to_fit();
+    ivpt.texture_coordinates.shrink_to_fit();
+    ivpt.texture.shrink_to_fit();
+    ivpt.dirty.shrink_to_fit();
+}
+
+void shrink_to_fit(IVPNTextured &ivpnt) {
+    ivpnt.indices.shrink_to_fit();
+    ivpnt.xyz_positions.shrink_to_fit();
+    ivpnt.normals.shrink_to_fit();
+    ivpnt.texture_coordinates.shrink_to_fit();
+    ivpnt.texture.shrink_to_fit();
+    ivpnt.dirty.shrink_to_fit();
+}
+
+void compute_vertex_normals(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                            std::vector<glm::vec3> &out) {
+    out.assign(xyz_positions.size(), glm::vec3(0));
+    for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+        unsigned int a = indices[t], b = indices[t + 1], c = indices[t + 2];
+        // the unnormalized cross product is twice the area, which is the weighting we want
+        glm::vec3 n = glm::cross(xyz_positions[b] - xyz_positions[a], xyz_positions[c] - xyz_positions[a]);
+        out[a] += n;
+        out[b] += n;
+        out[c] += n;
+    }
+    for (glm::vec3 &n : out) {
+        float length = glm::length(n);
+        n = length > 0 ? n / length : glm::vec3(0, 1, 0);
+    }
+}
+
+IndexedVertexPositions to_indexed_vertex_positions(IVPSolidColor ivpsc) {
+    IndexedVertexPositions ivp(std::move(ivpsc.indices), std::move(ivpsc.xyz_positions));
+    ivp.transform = std::move(ivpsc.transform);
+    return ivp;
+}
+
+IndexedVertexPositions to_indexed_vertex_positions(IVPTextured ivpt) {
+    IndexedVertexPositions ivp(std::move(ivpt.indices), std::move(ivpt.xyz_positions));
+    ivp.transform = std::move(ivpt.transform);
+    return ivp;
+}
+
+IndexedVertexPositions to_indexed_vertex_positions(IVPNTextured ivpnt) {
+    IndexedVertexPositions ivp(std::move(ivpnt.indices), std::move(ivpnt.xyz_positions));
+    ivp.transform = std::move(ivpnt.transform);
+    return ivp;
+}
+
+IVPSolidColor to_ivp_solid_color(IndexedVertexPositions ivp, const glm::vec3 &color) {
+    std::vector<glm::vec3> rgb_colors(ivp.xyz_positions.size(), color);
+    IVPSolidColor ivpsc(std::move(ivp.indices), std::move(ivp.xyz_positions), std::move(rgb_colors));
+    ivpsc.transform = std::move(ivp.transform);
+    return ivpsc;
+}
+
+IVPSolidColor to_ivp_solid_color(IVPTextured ivpt, const glm::vec3 &color) {
+    std::vector<glm::vec3> rgb_colors(ivpt.xyz_positions.size(), color);
+    IVPSolidColor ivpsc(std::move(ivpt.indices), std::move(ivpt.xyz_positions), std::move(rgb_colors));
+    ivpsc.texture_coordinates = std::move(ivpt.texture_coordinates);
+    ivpsc.transform = std::move(ivpt.transform);
+    return ivpsc;
+}
+
+IVPSolidColor to_ivp_solid_color(IVPNTextured ivpnt, const glm::vec3 &color) {
+    std::vector<glm::vec3> rgb_colors(ivpnt.xyz_positions.size(), color);
+    IVPSolidColor ivpsc(std::move(ivpnt.indices), std::move(ivpnt.xyz_positions), std::move(rgb_colors));
+    ivpsc.texture_coordinates = std::move(ivpnt.texture_coordinates);
+    ivpsc.transform = std::move(ivpnt.transform);
+    return ivpsc;
+}
+
+IVPTextured to_ivp_textured(IndexedVertexPositions ivp, const std::string &texture) {
+    std::vector<glm::vec2> texture_coordinates(ivp.xyz_positions.size(), glm::vec2(0));
+    IVPTextured ivpt(std::move(ivp.indices), std::move(ivp.xyz_positions), std::move(texture_coordinates), texture);
+    ivpt.transform = std::move(ivp.transform);
+    return ivpt;
+}
+
+IVPTextured to_ivp_textured(IVPNTextured ivpnt) {
+    IVPTextured ivpt(std::move(ivpnt.indices), std::move(ivpnt.xyz_positions), std::move(ivpnt.texture_coordinates));
+    ivpt.texture = std::move(ivpnt.texture);
+    ivpt.transform = std::move(ivpnt.transform);
+    return ivpt;
+}
+
+IVPNTextured to_ivpn_textured(IndexedVertexPositions ivp, const std::string &texture) {
+    std::vector<glm::vec3> normals;
+    compute_vertex_normals(ivp.indices, ivp.xyz_positions, normals);
+    std::vector<glm::vec2> texture_coordinates(ivp.xyz_positions.size(), glm::vec2(0));
+    IVPNTextured ivpnt(std::move(ivp.indices), std::move(ivp.xyz_positions), std::move(normals),
+                       std::move(texture_coordinates), texture);
+    ivpnt.transform = std::move(ivp.transform);
+    return ivpnt;
+}
+
+IVPNTextured to_ivpn_textured(IVPTextured ivpt) {
+    std::vector<glm::vec3> normals;
+    compute_vertex_normals(ivpt.indices, ivpt.xyz_positions, normals);
+    IVPNTextured ivpnt(std::move(ivpt.indices), std::move(ivpt.xyz_positions), std::move(normals),
+                       std::move(ivpt.texture_coordinates));
+    ivpnt.texture = std::move(ivpt.texture);
+    ivpnt.transform = std::move(ivpt.transform);
+    return ivpnt;
+}
+
+namespace {
+
+// set on the pool's own threads, see run_work_stealing
+thread_local bool on_pool_thread = false;
+
+/**
+ * threads kept alive between run_work_stealing calls, so short parallel sections like a merge or one occluder draw do
+ * not create and join threads every time. jobs run in submission order on whichever thread is idle.
+ */
+class WorkerPool {
+  public:
+    static WorkerPool &get() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // grows to at least thread_count threads, the pool never shrinks
+    void reserve(std::size_t thread_count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (threads.size() < thread_count) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+  private:
+    void work() {
+        on_pool_thread = true;
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
+
+struct TaskDeque {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+};
+
+// shared between the caller and its helper jobs, a helper that only starts after the caller closed the run returns
+// without touching it, so the caller never waits on jobs still queued behind other work in the pool
+struct WorkStealingRun {
+    WorkStealingRun(std::size_t deque_count, const std::function<void(std::size_t, unsigned int)> &body)
+        : deques(deque_count), body(body) {}
+    std::vector<TaskDeque> deques;
+    const std::function<void(std::size_t, unsigned int)> &body;
+    std::mutex mutex;
+    std::condition_variable helpers_done;
+    unsigned int active_helpers = 0;
+    bool closed = false;
+};
+
+void run_worker(WorkStealingRun &run, unsigned int worker) {
+    const std::size_t worker_count = run.deques.size();
+    for (;;) {
+        std::size_t task = 0;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> lock(run.deques[worker].mutex);
+            if (!run.deques[worker].tasks.empty()) {
+                task = run.deques[worker].tasks.back();
+                run.deques[worker].tasks.pop_back();
+                found = true;
+            }
+        }
+        // steal from the front, the far end from where the owner works
+        for (std::size_t offset = 1; !found && offset < worker_count; offset++) {
+            TaskDeque &victim = run.deques[(worker + offset) % worker_count];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                found = true;
+            }
+        }
+        // no tasks are ever added, so once every deque is empty the work is done
+        if (!found) {
+            return;
+        }
+        run.body(task, worker);
+    }
+}
+
+// closes the run and waits for the helpers that already started, called before returning or rethrowing
+void finish_run(WorkStealingRun &run) {
+    std::unique_lock<std::mutex> lock(run.mutex);
+    run.closed = true;
+    run.helpers_done.wait(lock, [&] { return run.active_helpers == 0; });
+}
+
+} // namespace
+
+void run_work_stealing(std::size_t task_count, unsigned int thread_count,
+                       const std::function<void(std::size_t task, unsigned int worker)> &body) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = static_cast<unsigned int>(std::min<std::size_t>(thread_count, std::max<std::size_t>(1, task_count)));
+    // a task that starts its own parallel section runs it inline, its helpers could otherwise sit in the queue behind
+    // the very tasks waiting for them
+    if (thread_count == 1 || on_pool_thread) {
+        for (std::size_t task = 0; task < task_count; task++) {
+            body(task, 0);
+        }
+        return;
+    }
+
+    // contiguous blocks per worker, neighbouring tasks are often similar so this keeps stealing rare
+    auto run = std::make_shared<WorkStealingRun>(thread_count, body);
+    for (unsigned int w = 0; w < thread_count; w++) {
+        std::size_t begin = task_count * w / thread_count, end = task_count * (w + 1) / thread_count;
+        for (std::size_t task = begin; task < end; task++) {
+            run->deques[w].tasks.push_back(task);
+        }
+    }
+
+    WorkerPool &pool = WorkerPool::get();
+    pool.reserve(thread_count - 1);
+    for (unsigned int w = 1; w < thread_count; w++) {
+        pool.submit([run, w] {
+            {
+                std::lock_guard<std::mutex> lock(run->mutex);
+                if (run->closed) {
+                    return;
+                }
+                run->active_helpers++;
+            }
+            run_worker(*run, w);
+            {
+                std::lock_guard<std::mutex> lock(run->mutex);
+                run->active_helpers--;
+            }
+            run->helpers_done.notify_all();
+        });
+    }
+    // the caller works too, so every task gets done even when all pool threads are busy with other runs
+    try {
+        run_worker(*run, 0);
+    } catch (...) {
+        finish_run(*run);
+        throw;
+    }
+    finish_run(*run);
+}
+
+void InFlightBudget::wait_for_room() {
+    std::unique_lock<std::mutex> lock(mutex);
+    room_available.wait(lock, [&] { return bytes < max_bytes; });
+}
+
+void InFlightBudget::add(std::size_t added) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes += added;
+    peak_bytes = std::max(peak_bytes, bytes);
+}
+
+void InFlightBudget::remove(std::size_t removed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes -= removed;
+    }
+    room_available.notify_all();
+}
+
+std::size_t InFlightBudget::get_peak_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peak_bytes;
+}
+
+namespace {
+
+constexpr unsigned int screen_tile_size = 32;
+// points this close to the eye are clipped, keeps the divide by w finite for projections without a near plane
+constexpr float near_clip_w = 1e-5f;
+// triangles are also clipped to |x|, |y| <= guard_band * w, far enough off screen that it never changes coverage but
+// keeps window coordinates small enough for the edge functions to stay exact
+constexpr float guard_band = 16.0f;
+
+// x and y in pixels, z is window depth in [0, 1]
+struct ScreenTriangle {
+    glm::vec3 a, b, c;
+    std::uint32_t id;
+};
+
+glm::vec3 to_window(const glm::vec4 &clip, unsigned int width, unsigned int height) {
+    float inverse_w = 1.0f / clip.w;
+    return glm::vec3((clip.x * inverse_w * 0.5f + 0.5f) * width, (clip.y * inverse_w * 0.5f + 0.5f) * height,
+                     clip.z * inverse_w * 0.5f + 0.5f);
+}
+
+// the clip planes as signed distances, a point is kept where every one is >= 0
+constexpr int clip_plane_count = 6;
+float clip_plane_distance(const glm::vec4 &p, int plane) {
+    switch (plane) {
+    case 0:
+        return p.z + p.w; // near
+    case 1:
+        return p.w - near_clip_w;
+    case 2:
+        return guard_band * p.w - p.x;
+    case 3:
+        return guard_band * p.w + p.x;
+    case 4:
+        return guard_band * p.w - p.y;
+    default:
+        return guard_band * p.w + p.y;
+    }
+}
+
+// one sutherland hodgman step, returns the size of out which needs room for one more vertex than in
+std::size_t clip_polygon(const glm::vec4 *in, std::size_t size, glm::vec4 *out, int plane) {
+    std::size_t out_size = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        const glm::vec4 &current = in[i];
+        const glm::vec4 &next = in[(i + 1) % size];
+        float current_distance = clip_plane_distance(current, plane);
+        float next_distance = clip_plane_distance(next, plane);
+        if (current_distance >= 0) {
+            out[out_size++] = current;
+        }
+        if ((current_distance >= 0) != (next_distance >= 0)) {
+            float t = current_distance / (current_distance - next_distance);
+            out[out_size++] = current + (next - current) * t;
+        }
+    }
+    return out_size;
+}
+
+// clips against the near plane and the guard band, the screen edges themselves are handled by the pixel bounds
+void add_clipped_triangle(const std::array<glm::vec4, 3> &clip, unsigned int width, unsigned int height,
+                          std::uint32_t id, std::vector<ScreenTriangle> &out) {
+    bool inside = true;
+    for (int plane = 0; plane < clip_plane_count && inside; plane++) {
+        inside = clip_plane_distance(clip[0], plane) >= 0 && clip_plane_distance(clip[1], plane) >= 0 &&
+                 clip_plane_distance(clip[2], plane) >= 0;
+    }
+    if (inside) {
+        out.push_back({to_window(clip[0], width, height), to_window(clip[1], width, height),
+                       to_window(clip[2], width, height), id});
+        return;
+    }
+    // every plane can add at most one vertex
+    std::array<glm::vec4, 3 + clip_plane_count> polygon, scratch;
+    std::copy(clip.begin(), clip.end(), polygon.begin());
+    std::size_t polygon_size = 3;
+    for (int plane = 0; plane < clip_plane_count && polygon_size >= 3; plane++) {
+        polygon_size = clip_polygon(polygon.data(), polygon_size, scratch.data(), plane);
+        std::swap(polygon, scratch);
+    }
+    if (polygon_size < 3) {
+        return;
+    }
+    glm::vec3 first = to_window(polygon[0], width, height);
+    for (std::size_t i = 1; i + 1 < polygon_size; i++) {
+        out.push_back({first, to_window(polygon[i], width, height), to_window(polygon[i + 1], width, height), id});
+    }
+}
+
+// clamps before any cast to int, which is undefined for values that do not fit (and for nan, which maps to low)
+float clamp_window_coordinate(float v, float low, float high) { return v >= low ? (v <= high ? v : high) : low; }
+
+void add_screen_triangles(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                          const glm::mat4 &model_view_projection, unsigned int width, unsigned int height,
+                          std::uint32_t first_id, std::vector<glm::vec4> &clip_positions,
+                          std::vector<ScreenTriangle> &out) {
+    clip_positions.resize(xyz_positions.size());
+    for (std::size_t v = 0; v < xyz_positions.size(); v++) {
+        clip_positions[v] = model_view_projection * glm::vec4(xyz_positions[v], 1.0f);
+    }
+    for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+        if (indices[t] >= clip_positions.size() || indices[t + 1] >= clip_positions.size() ||
+            indices[t + 2] >= clip_positions.size()) {
+            continue;
+        }
+        std::array<glm::vec4, 3> clip = {clip_positions[indices[t]], clip_positions[indices[t + 1]],
+                                         clip_positions[indices[t + 2]]};
+        // trivially outside one of the side planes, saves binning triangles that cover nothing
+        bool outside = false;
+        for (int axis = 0; axis < 2 && !outside; axis++) {
+            outside = (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w) ||
+                      (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w);
+        }
+        if (!outside) {
+            add_clipped_triangle(clip, width, height, first_id + static_cast<std::uint32_t>(t / 3), out);
+        }
+    }
+}
+
+/**
+ * bins the triangles into screen tiles and rasterizes the tiles in parallel, every pixel belongs to exactly one tile
+ * so write_pixel(pixel, z, triangle) never races. pixel centers are sampled and both windings are drawn.
+ */
+template <typename WritePixel>
+void rasterize_tiled(const std::vector<ScreenTriangle> &triangles, unsigned int width, unsigned int height,
+                     WritePixel write_pixel) {
+    const unsigned int tiles_x = (width + screen_tile_size - 1) / screen_tile_size;
+    const unsigned int tiles_y = (height + screen_tile_size - 1) / screen_tile_size;
+    if (triangles.empty() || tiles_x == 0 || tiles_y == 0) {
+        return;
+    }
+
+    struct PixelBounds {
+        int min_x, min_y, max_x, max_y;
+    };
+    auto pixel_bounds = [&](const ScreenTriangle &triangle) {
+        // pixel x is covered when its center x + 0.5 lies in the triangle, an empty range comes out as max < min
+        const float last_x = static_cast<float>(width) - 1, last_y = static_cast<float>(height) - 1;
+        float min_x = std::ceil(std::min({triangle.a.x, triangle.b.x, triangle.c.x}) - 0.5f);
+        float min_y = std::ceil(std::min({triangle.a.y, triangle.b.y, triangle.c.y}) - 0.5f);
+        float max_x = std::floor(std::max({triangle.a.x, triangle.b.x, triangle.c.x}) - 0.5f);
+        float max_y = std::floor(std::max({triangle.a.y, triangle.b.y, triangle.c.y}) - 0.5f);
+        return PixelBounds{static_cast<int>(clamp_window_coordinate(min_x, 0, last_x + 1)),
+                           static_cast<int>(clamp_window_coordinate(min_y, 0, last_y + 1)),
+                           static_cast<int>(clamp_window_coordinate(max_x, -1, last_x)),
+                           static_cast<int>(clamp_window_coordinate(max_y, -1, last_y))};
+    };
+
+    // counting sort of triangle indices by tile, like the spatial grid, so each bin is contiguous
+    std::vector<std::uint32_t> bin_starts(static_cast<std::size_t>(tiles_x) * tiles_y + 1, 0);
+    auto for_each_tile = [&](const PixelBounds &bounds, auto visit) {
+        if (bounds.min_x > bounds.max_x || bounds.min_y > bounds.max_y) {
+            return;
+        }
+        for (int ty = bounds.min_y / screen_tile_size; ty <= bounds.max_y / static_cast<int>(screen_tile_size); ty++) {
+            for (int tx = bounds.min_x / screen_tile_size; tx <= bounds.max_x / static_cast<int>(screen_tile_size);
+                 tx++) {
+                visit(static_cast<std::size_t>(ty) * tiles_x + tx);
+            }
+        }
+    };
+    for (const ScreenTriangle &triangle : triangles) {
+        for_each_tile(pixel_bounds(triangle), [&](std::size_t tile) { bin_starts[tile + 1]++; });
+    }
+    for (std::size_t tile = 0; tile + 1 < bin_starts.size(); tile++) {
+        bin_starts[tile + 1] += bin_starts[tile];
+    }
+    std::vector<std::uint32_t> binned(bin_starts.back());
+    std::vector<std::uint32_t> cursor(bin_starts.begin(), bin_starts.end() - 1);
+    for (std::size_t t = 0; t < triangles.size(); t++) {
+        for_each_tile(pixel_bounds(triangles[t]),
+                      [&](std::size_t tile) { binned[cursor[tile]++] = static_cast<std::uint32_t>(t); });
+    }
+
+    // one task per tile that has triangles, tiles own disjoint pixels so they need no synchronization. a draw that
+    // touches only a few tiles is not worth waking the pool for
+    std::vector<std::uint32_t> occupied_tiles;
+    for (std::size_t tile = 0; tile + 1 < bin_starts.size(); tile++) {
+        if (bin_starts[tile] < bin_starts[tile + 1]) {
+            occupied_tiles.push_back(static_cast<std::uint32_t>(tile));
+        }
+    }
+    constexpr std::size_t min_parallel_bin_entries = 64;
+    unsigned int thread_count = binned.size() < min_parallel_bin_entries ? 1 : 0;
+    run_work_stealing(occupied_tiles.size(), thread_count, [&](std::size_t task, unsigned int) {
+        const std::size_t tile = occupied_tiles[task];
+        const int tile_x0 = static_cast<int>(tile % tiles_x * screen_tile_size);
+        const int tile_y0 = static_cast<int>(tile / tiles_x * screen_tile_size);
+        const int tile_x1 = std::min<int>(tile_x0 + screen_tile_size, width) - 1;
+        const int tile_y1 = std::min<int>(tile_y0 + screen_tile_size, height) - 1;
+        for (std::uint32_t b = bin_starts[tile]; b < bin_starts[tile + 1]; b++) {
+            const ScreenTriangle &triangle = triangles[binned[b]];
+            glm::vec3 a = triangle.a, v1 = triangle.b, v2 = triangle.c;
+            float area = (v1.x - a.x) * (v2.y - a.y) - (v1.y - a.y) * (v2.x - a.x);
+            if (area == 0) {
+                continue;
+            }
+            if (area < 0) {
+                std::swap(v1, v2);
+                area = -area;
+            }
+            PixelBounds bounds = pixel_bounds(triangle);
+            int x0 = std::max(bounds.min_x, tile_x0), x1 = std::min(bounds.max_x, tile_x1);
+            int y0 = std::max(bounds.min_y, tile_y0), y1 = std::min(bounds.max_y, tile_y1);
+            float inverse_area = 1.0f / area;
+            // edge functions are linear in x, so only the row start is evaluated in full. every pixel is offset from
+            // the row start rather than accumulated step by step, which keeps the sse2 and scalar paths bit identical
+            float step_x0 = -(v2.y - v1.y), step_x1 = -(a.y - v2.y), step_x2 = -(v1.y - a.y);
+#if defined(__SSE2__)
+            const __m128 lane_offsets = _mm_set_ps(3, 2, 1, 0);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 steps0 = _mm_set1_ps(step_x0), steps1 = _mm_set1_ps(step_x1), steps2 = _mm_set1_ps(step_x2);
+            const __m128 a_z = _mm_set1_ps(a.z), v1_z = _mm_set1_ps(v1.z), v2_z = _mm_set1_ps(v2.z);
+            const __m128 inverse_areas = _mm_set1_ps(inverse_area);
+#endif
+            for (int y = y0; y <= y1; y++) {
+                float py = y + 0.5f, px = x0 + 0.5f;
+                float row_w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+                float row_w1 = (a.x - v2.x) * (py - v2.y) - (a.y - v2.y) * (px - v2.x);
+                float row_w2 = (v1.x - a.x) * (py - a.y) - (v1.y - a.y) * (px - a.x);
+                std::size_t row = static_cast<std::size_t>(y) * width;
+                int x = x0;
+#if defined(__SSE2__)
+                // 4 pixels at a time, covered lanes are written in x order like the scalar loop would
+                const __m128 row_w0s = _mm_set1_ps(row_w0), row_w1s = _mm_set1_ps(row_w1);
+                const __m128 row_w2s = _mm_set1_ps(row_w2);
+                for (; x + 3 <= x1; x += 4) {
+                    __m128 offset = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - x0)), lane_offsets);
+                    __m128 w0 = _mm_add_ps(row_w0s, _mm_mul_ps(steps0, offset));
+                    __m128 w1 = _mm_add_ps(row_w1s, _mm_mul_ps(steps1, offset));
+                    __m128 w2 = _mm_add_ps(row_w2s, _mm_mul_ps(steps2, offset));
+                    // tests for outside rather than inside so that nan weights count as covered, as they do below
+                    __m128 outside =
+                        _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(w0, zero), _mm_cmplt_ps(w1, zero)), _mm_cmplt_ps(w2, zero));
+                    int covered = ~_mm_movemask_ps(outside) & 0xf;
+                    if (covered == 0) {
+                        continue;
+                    }
+                    __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, a_z), _mm_mul_ps(w1, v1_z)), _mm_mul_ps(w2, v2_z));
+                    alignas(16) float depths[4];
+                    _mm_store_ps(depths, _mm_mul_ps(z, inverse_areas));
+                    for (int lane = 0; lane < 4; lane++) {
+                        if (covered & (1 << lane)) {
+                            write_pixel(row + x + lane, depths[lane], triangle);
+                        }
+                    }
+                }
+#endif
+                for (; x <= x1; x++) {
+                    float offset = static_cast<float>(x - x0);
+                    float w0 = row_w0 + step_x0 * offset;
+                    float w1 = row_w1 + step_x1 * offset;
+                    float w2 = row_w2 + step_x2 * offset;
+                    if (w0 < 0 || w1 < 0 || w2 < 0) {
+                        continue;
+                    }
+                    float z = (w0 * a.z + w1 * v1.z + w2 * v2.z) * inverse_area;
+                    write_pixel(row + x, z, triangle);
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+    : width(width), height(height), depth(static_cast<std::size_t>(width) * height, 1.0f) {}
+
+void OcclusionBuffer::clear() {
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    max_depth_levels.clear();
+}
+
+void OcclusionBuffer::draw(IndexedVertexPositionsView occluder) {
+    draw(occluder.indices, occluder.xyz_positions,
+         occluder.transform != nullptr ? occluder.transform->get_transform_matrix() : glm::mat4(1));
+}
+
+void OcclusionBuffer::draw(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                           const glm::mat4 &model_matrix) {
+    DRAW_INFO_PROFILE_SCOPE(rasterization, indices.size() * sizeof(unsigned int));
+    std::vector<glm::vec4> clip_positions;
+    std::vector<ScreenTriangle> triangles;
+    add_screen_triangles(indices, xyz_positions, view_projection * model_matrix, width, height, 0, clip_positions,
+                         triangles);
+    rasterize_tiled(triangles, width, height, [&](std::size_t pixel, float z, const ScreenTriangle &) {
+        depth[pixel] = std::min(depth[pixel], z);
+    });
+    // the hierarchy is stale now, is_visible falls back to level 0 until it is rebuilt
+    max_depth_levels.clear();
+}
+
+void OcclusionBuffer::build_hierarchy() {
+    max_depth_levels.clear();
+    unsigned int level_width = width, level_height = height;
+    const std::vector<float> *previous = &depth;
+    while (level_width > 1 || level_height > 1) {
+        unsigned int next_width = (level_width + 1) / 2, next_height = (level_height + 1) / 2;
+        std::vector<float> level(static_cast<std::size_t>(next_width) * next_height);
+        for (unsigned int y = 0; y < next_height; y++) {
+            for (unsigned int x = 0; x < next_width; x++) {
+                // odd sizes repeat the last row or column instead of reading past it
+                unsigned int x0 = 2 * x, x1 = std::min(2 * x + 1, level_width - 1);
+                unsigned int y0 = 2 * y, y1 = std::min(2 * y + 1, level_height - 1);
+                level[static_cast<std::size_t>(y) * next_width + x] =
+                    std::max({(*previous)[static_cast<std::size_t>(y0) * level_width + x0],
+                              (*previous)[static_cast<std::size_t>(y0) * level_width + x1],
+                              (*previous)[static_cast<std::size_t>(y1) * level_width + x0],
+                              (*previous)[static_cast<std::size_t>(y1) * level_width + x1]});
+            }
+        }
+        max_depth_levels.push_back(std::move(level));
+        previous = &max_depth_levels.back();
+        level_width = next_width;
+        level_height = next_height;
+    }
+}
+
+bool OcclusionBuffer::is_visible(const glm::vec3 &local_min, const glm::vec3 &local_max,
+                                 const glm::mat4 &model_matrix) const {
+    if (width == 0 || height == 0) {
+        return true;
+    }
+    glm::mat4 model_view_projection = view_projection * model_matrix;
+    glm::vec2 screen_min(std::numeric_limits<float>::max()), screen_max(std::numeric_limits<float>::lowest());
+    float nearest_depth = std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 p((corner & 1) ? local_max.x : local_min.x, (corner & 2) ? local_max.y : local_min.y,
+                    (corner & 4) ? local_max.z : local_min.z);
+        glm::vec4 clip = model_view_projection * glm::vec4(p, 1.0f);
+        // a box reaching past the near plane contains the camera's view of it, keep it
+        if (clip.z < -clip.w || clip.w <= near_clip_w) {
+            return true;
+        }
+        glm::vec3 window = to_window(clip, width, height);
+        screen_min = glm::min(screen_min, glm::vec2(window.x, window.y));
+        screen_max = glm::max(screen_max, glm::vec2(window.x, window.y));
+        nearest_depth = std::min(nearest_depth, window.z);
+    }
+    if (screen_max.x < 0 || screen_max.y < 0 || screen_min.x >= width || screen_min.y >= height ||
+        nearest_depth > 1.0f) {
+        return false;
+    }
+    const float last_x = static_cast<float>(width) - 1, last_y = static_cast<float>(height) - 1;
+    int x0 = static_cast<int>(clamp_window_coordinate(screen_min.x, 0, last_x));
+    int y0 = static_cast<int>(clamp_window_coordinate(screen_min.y, 0, last_y));
+    int x1 = static_cast<int>(clamp_window_coordinate(screen_max.x, 0, last_x));
+    int y1 = static_cast<int>(clamp_window_coordinate(screen_max.y, 0, last_y));
+
+    // the smallest level where the rectangle spans at most two texels each way, so at most four reads
+    std::size_t level = 0;
+    while (level < max_depth_levels.size() &&
+           ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        level++;
+    }
+    const std::vector<float> &texels = level == 0 ? depth : max_depth_levels[level - 1];
+    unsigned int level_width = std::max(1u, (width + (1u << level) - 1) >> level);
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            if (nearest_depth <= texels[static_cast<std::size_t>(y) * level_width + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionBuffer::is_visible(IndexedVertexPositionsView object) const {
+    if (object.xyz_positions.empty()) {
+        return false;
+    }
+    glm::vec3 min = object.xyz_positions[0], max = object.xyz_positions[0];
+    for (const glm::vec3 &p : object.xyz_positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    return is_visible(min, max, object.transform != nullptr ? object.transform->get_transform_matrix() : glm::mat4(1));
+}
+
+PickingBuffer::PickingBuffer(unsigned int width, unsigned int height)
+    : width(width), height(height), depth(static_cast<std::size_t>(width) * height, 1.0f),
+      object_ids(depth.size(), no_object), triangle_ids(depth.size(), 0) {}
+
+void PickingBuffer::render(const std::vector<IndexedVertexPositionsView> &objects) {
+    std::size_t index_count = 0;
+    for (const IndexedVertexPositionsView &object : objects) {
+        index_count += object.indices.size();
+    }
+    DRAW_INFO_PROFILE_SCOPE(rasterization, index_count * sizeof(unsigned int));
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    std::fill(object_ids.begin(), object_ids.end(), no_object);
+
+    std::vector<glm::vec4> clip_positions;
+    std::vector<ScreenTriangle> triangles;
+    // clipping can split a triangle, so the owning object is recorded per screen triangle rather than derived
+    std::vector<std::uint32_t> triangle_objects;
+    triangles.reserve(index_count / 3);
+    for (std::size_t o = 0; o < objects.size(); o++) {
+        const IndexedVertexPositionsView &object = objects[o];
+        glm::mat4 model_matrix = object.transform != nullptr ? object.transform->get_transform_matrix() : glm::mat4(1);
+        add_screen_triangles(object.indices, object.xyz_positions, view_projection * model_matrix, width, height, 0,
+                             clip_positions, triangles);
+        triangle_objects.resize(triangles.size(), static_cast<std::uint32_t>(o));
+    }
+
+    rasterize_tiled(triangles, width, height, [&](std::size_t pixel, float z, const ScreenTriangle &triangle) {
+        if (z < depth[pixel]) {
+            depth[pixel] = z;
+            object_ids[pixel] = triangle_objects[static_cast<std::size_t>(&triangle - triangles.data())];
+            triangle_ids[pixel] = triangle.id;
+        }
+    });
+}
+
+PickResult PickingBuffer::pick(unsigned int x, unsigned int y) const {
+    PickResult result;
+    if (x >= width || y >= height) {
+        return result;
+    }
+    std::size_t pixel = static_cast<std::size_t>(y) * width + x;
+    if (object_ids[pixel] == no_object) {
+        return result;
+    }
+    result.hit = true;
+    result.object = object_ids[pixel];
+    result.triangle = triangle_ids[pixel];
+    result.depth = depth[pixel];
+    return result;
+}
+
+namespace {
+
+// true when (a, b, c) is one of the rotations of (x, y, z), i.e. the same triangle with the same winding
+bool same_winding(unsigned int a, unsigned int b, unsigned int c, unsigned int x, unsigned int y, unsigned int z) {
+    return (a == x && b == y && c == z) || (a == y && b == z && c == x) || (a == z && b == x && c == y);
+}
+
+/**
+ * edge slot 3 * t + e is the edge of triangle t from corner e to corner e + 1. slots holding the same undirected edge
+ * form a run, stored compressed: run_of[slot] names the run, and run_slots[run_starts[run], run_starts[run + 1]) lists
+ * its slots in triangle order. built with a counting sort on the lower vertex followed by an insertion sort of each
+ * (small) vertex bucket on the higher one, so finding every triangle across an edge is one lookup instead of a search.
+ */
+struct EdgeAdjacency {
+    std::vector<std::uint32_t> run_of;
+    std::vector<std::uint32_t> run_starts;
+    std::vector<std::uint32_t> run_slots;
+
+    EdgeAdjacency(ArrayView<unsigned int> indices, const std::vector<bool> &skip) {
+        const std::size_t triangle_count = indices.size() / 3;
+        unsigned int vertex_count = 0;
+        for (std::size_t i = 0; i < triangle_count * 3; i++) {
+            vertex_count = std::max(vertex_count, indices[i] + 1);
+        }
+        auto for_each_edge = [&](auto visit) {
+            for (std::size_t t = 0; t < triangle_count; t++) {
+                if (skip[t]) {
+                    continue;
+                }
+                for (std::size_t e = 0; e < 3; e++) {
+                    unsigned int a = indices[3 * t + e], b = indices[3 * t + (e + 1) % 3];
+                    visit(static_cast<std::uint32_t>(3 * t + e), std::min(a, b), std::max(a, b));
+                }
+            }
+        };
+
+        std::vector<std::uint32_t> starts(static_cast<std::size_t>(vertex_count) + 1, 0);
+        for_each_edge([&](std::uint32_t, unsigned int low, unsigned int) { starts[low + 1]++; });
+        for (std::size_t v = 0; v < vertex_count; v++) {
+            starts[v + 1] += starts[v];
+        }
+        struct Edge {
+            unsigned int high;
+            std::uint32_t slot;
+        };
+        std::vector<Edge> edges(starts.back());
+        std::vector<std::uint32_t> cursor(starts.begin(), starts.end() - 1);
+        for_each_edge([&](std::uint32_t slot, unsigned int low, unsigned int high) {
+            edges[cursor[low]++] = Edge{high, slot};
+        });
+
+        run_of.assign(triangle_count * 3, 0);
+        run_slots.resize(edges.size());
+        run_starts.reserve(edges.size() + 1);
+        auto by_high = [](const Edge &x, const Edge &y) { return x.high < y.high; };
+        for (std::size_t v = 0; v < vertex_count; v++) {
+            // the sorts are stable so equal edges stay in triangle order, most vertices have a handful of edges but a
+            // fan center can have thousands
+            if (starts[v + 1] - starts[v] > 32) {
+                std::stable_sort(edges.begin() + starts[v], edges.begin() + starts[v + 1], by_high);
+            }
+            for (std::size_t i = starts[v] + 1; i < starts[v + 1]; i++) {
+                Edge edge = edges[i];
+                std::size_t j = i;
+                for (; j > starts[v] && by_high(edge, edges[j - 1]); j--) {
+                    edges[j] = edges[j - 1];
+                }
+                edges[j] = edge;
+            }
+            for (std::size_t i = starts[v]; i < starts[v + 1]; i++) {
+                if (i == starts[v] || edges[i].high != edges[i - 1].high) {
+                    run_starts.push_back(static_cast<std::uint32_t>(i));
+                }
+                run_slots[i] = edges[i].slot;
+                run_of[edges[i].slot] = static_cast<std::uint32_t>(run_starts.size() - 1);
+            }
+        }
+        run_starts.push_back(static_cast<std::uint32_t>(run_slots.size()));
+    }
+
+    std::size_t run_size(std::size_t slot) const { return run_starts[run_of[slot] + 1] - run_starts[run_of[slot]]; }
+};
+
+} // namespace
+
+StripifyResult stripify(ArrayView<unsigned int> indices, unsigned int restart_index) {
+    DRAW_INFO_PROFILE_SCOPE(stripify, indices.size() * sizeof(unsigned int));
+    StripifyResult result;
+    result.triangle_list_index_count = indices.size() - indices.size() % 3;
+    const std::size_t triangle_count = indices.size() / 3;
+
+    std::vector<bool> used(triangle_count, false);
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        unsigned int a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+        used[t] = a == b || b == c || a == c;
+    }
+    const EdgeAdjacency adjacency(indices, used);
+
+    // the edge slot of triangle t joining p and q
+    auto slot_of = [&](std::size_t t, unsigned int p, unsigned int q) {
+        for (std::size_t e = 0; e < 3; e++) {
+            unsigned int a = indices[3 * t + e], b = indices[3 * t + (e + 1) % 3];
+            if ((a == p && b == q) || (a == q && b == p)) {
+                return 3 * t + e;
+            }
+        }
+        return 3 * t;
+    };
+    // the unused triangle across edge (p, q) of triangle from that the strip can take next, given the strip's
+    // winding parity
+    auto find_next = [&](std::size_t from, unsigned int p, unsigned int q, bool odd_position,
+                         unsigned int &third) -> std::size_t {
+        std::uint32_t run = adjacency.run_of[slot_of(from, p, q)];
+        for (std::uint32_t i = adjacency.run_starts[run]; i < adjacency.run_starts[run + 1]; i++) {
+            std::size_t t = adjacency.run_slots[i] / 3;
+            if (used[t]) {
+                continue;
+            }
+            unsigned int x = indices[3 * t], y = indices[3 * t + 1], z = indices[3 * t + 2];
+            unsigned int c = (x != p && x != q) ? x : (y != p && y != q) ? y : z;
+            bool winding_matches = odd_position ? same_winding(q, p, c, x, y, z) : same_winding(p, q, c, x, y, z);
+            if (winding_matches) {
+                third = c;
+                return t;
+            }
+        }
+        return triangle_count;
+    };
+
+    // start with the triangles that have the fewest neighbours, a counting sort keeps equal counts in index order
+    std::vector<std::uint32_t> neighbour_counts(triangle_count, 0);
+    std::uint32_t max_neighbour_count = 0;
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        if (used[t]) {
+            continue;
+        }
+        for (std::size_t e = 0; e < 3; e++) {
+            neighbour_counts[t] += static_cast<std::uint32_t>(adjacency.run_size(3 * t + e) - 1);
+        }
+        max_neighbour_count = std::max(max_neighbour_count, neighbour_counts[t]);
+    }
+    std::vector<std::uint32_t> count_starts(static_cast<std::size_t>(max_neighbour_count) + 2, 0);
+    for (std::uint32_t count : neighbour_counts) {
+        count_starts[count + 1]++;
+    }
+    for (std::size_t i = 0; i + 1 < count_starts.size(); i++) {
+        count_starts[i + 1] += count_starts[i];
+    }
+    std::vector<std::uint32_t> start_order(triangle_count);
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        start_order[count_starts[neighbour_counts[t]]++] = static_cast<std::uint32_t>(t);
+    }
+
+    result.indices.reserve(result.triangle_list_index_count);
+    std::vector<unsigned int> strip;
+    for (std::uint32_t start : start_order) {
+        if (used[start]) {
+            continue;
+        }
+        used[start] = true;
+        std::array<unsigned int, 3> corners = {indices[3 * start], indices[3 * start + 1], indices[3 * start + 2]};
+        // begin with the rotation whose leading edge can continue, otherwise the strip ends after one triangle
+        std::size_t rotation = 0;
+        for (std::size_t r = 0; r < 3; r++) {
+            unsigned int third;
+            if (find_next(start, corners[(r + 1) % 3], corners[(r + 2) % 3], true, third) != triangle_count) {
+                rotation = r;
+                break;
+            }
+        }
+        strip.assign({corners[rotation], corners[(rotation + 1) % 3], corners[(rotation + 2) % 3]});
+        std::size_t last = start;
+        for (;;) {
+            unsigned int third;
+            // the next triangle is at position size - 2, odd positions are wound in reverse
+            std::size_t next = find_next(last, strip[strip.size() - 2], strip[strip.size() - 1],
+                                         (strip.size() - 2) % 2 == 1, third);
+            if (next == triangle_count) {
+                break;
+            }
+            used[next] = true;
+            strip.push_back(third);
+            last = next;
+        }
+        if (result.strip_count > 0) {
+            result.indices.push_back(restart_index);
+        }
+        result.indices.insert(result.indices.end(), strip.begin(), strip.end());
+        result.strip_count++;
+    }
+
+    result.index_reduction = result.triangle_list_index_count > 0
+                                 ? 1.0f - static_cast<float>(result.indices.size()) /
+                                              static_cast<float>(result.triangle_list_index_count)
+                                 : 0;
+    return result;
+}
+
+std::vector<unsigned int> unstripify(ArrayView<unsigned int> strip_indices, unsigned int restart_index) {
+    std::vector<unsigned int> triangles;
+    std::size_t strip_begin = 0;
+    for (std::size_t i = 0; i <= strip_indices.size(); i++) {
+        if (i < strip_indices.size() && strip_indices[i] != restart_index) {
+            continue;
+        }
+        for (std::size_t k = strip_begin; k + 2 < i; k++) {
+            unsigned int a = strip_indices[k], b = strip_indices[k + 1], c = strip_indices[k + 2];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            if ((k - strip_begin) % 2 == 1) {
+                std::swap(a, b);
+            }
+            triangles.insert(triangles.end(), {a, b, c});
+        }
+        strip_begin = i + 1;
+    }
+    return triangles;
+}
+
+namespace {
+
+enum class AnimationFrameKind : unsigned char { keyframe, delta_8, delta_16 };
+
+// shared by encoder and decoder so both reconstruct bit identical positions
+void apply_position_deltas(float *components, const std::int16_t *deltas, std::size_t count, float step) {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // unpacking a value with itself puts a copy in the high half of each 32 bit lane, the arithmetic shift back down
+    // sign extends it
+    const __m128 steps = _mm_set1_ps(step);
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(deltas + i));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        __m128 first = _mm_add_ps(_mm_loadu_ps(components + i), _mm_mul_ps(_mm_cvtepi32_ps(low), steps));
+        __m128 second = _mm_add_ps(_mm_loadu_ps(components + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(high), steps));
+        _mm_storeu_ps(components + i, first);
+        _mm_storeu_ps(components + i + 4, second);
+    }
+#endif
+    for (; i < count; i++) {
+        components[i] += static_cast<float>(deltas[i]) * step;
+    }
+}
+
+} // namespace
+
+EncodedAnimation encode_animation(const std::vector<IndexedVertexPositions> &frames,
+                                  const AnimationEncodingOptions &options) {
+    EncodedAnimation animation;
+    if (frames.empty()) {
+        animation.frame_offsets.push_back(0);
+        return animation;
+    }
+    animation.indices = frames[0].indices;
+    animation.vertex_count = frames[0].xyz_positions.size();
+    animation.frame_count = frames.size();
+    animation.step = 2 * options.precision;
+    for (const IndexedVertexPositions &frame : frames) {
+        if (frame.indices != animation.indices || frame.xyz_positions.size() != animation.vertex_count) {
+            throw std::runtime_error("draw_info: animation frames must share indices and vertex count");
+        }
+    }
+    DRAW_INFO_PROFILE_SCOPE(encoding, frames.size() * animation.vertex_count * sizeof(glm::vec3));
+
+    const std::size_t component_count = animation.vertex_count * 3;
+    std::vector<float> reconstructed(component_count);
+    std::vector<std::int16_t> deltas(component_count);
+    const std::size_t keyframe_interval = std::max<std::size_t>(1, options.keyframe_interval);
+    std::size_t frames_since_keyframe = 0;
+
+    for (std::size_t f = 0; f < frames.size(); f++) {
+        animation.frame_offsets.push_back(animation.data.size());
+        // data() rather than &[0].x, a frame of an empty mesh has no first element to take the address of
+        const float *target = reinterpret_cast<const float *>(frames[f].xyz_positions.data());
+
+        bool keyframe = f == 0 || frames_since_keyframe + 1 >= keyframe_interval || animation.step <= 0;
+        bool fits_8_bits = true;
+        for (std::size_t i = 0; i < component_count && !keyframe; i++) {
+            float quantized = std::round((target[i] - reconstructed[i]) / animation.step);
+            if (!(std::abs(quantized) <= std::numeric_limits<std::int16_t>::max())) {
+                keyframe = true;
+                break;
+            }
+            deltas[i] = static_cast<std::int16_t>(quantized);
+            fits_8_bits = fits_8_bits && deltas[i] >= std::numeric_limits<std::int8_t>::min() &&
+                          deltas[i] <= std::numeric_limits<std::int8_t>::max();
+        }
+
+        if (keyframe) {
+            animation.data.push_back(static_cast<unsigned char>(AnimationFrameKind::keyframe));
+            std::vector<unsigned char> encoded =
+                encode_vertices(frames[f].xyz_positions.data(), animation.vertex_count, sizeof(glm::vec3));
+            animation.data.insert(animation.data.end(), encoded.begin(), encoded.end());
+            std::copy_n(target, component_count, reconstructed.data());
+            frames_since_keyframe = 0;
+            continue;
+        }
+
+        AnimationFrameKind kind = fits_8_bits ? AnimationFrameKind::delta_8 : AnimationFrameKind::delta_16;
+        animation.data.push_back(static_cast<unsigned char>(kind));
+        for (std::int16_t delta : deltas) {
+            auto bits = static_cast<std::uint16_t>(delta);
+            animation.data.push_back(static_cast<unsigned char>(bits & 0xFF));
+            if (kind == AnimationFrameKind::delta_16) {
+                animation.data.push_back(static_cast<unsigned char>(bits >> 8));
+            }
+        }
+        apply_position_deltas(reconstructed.data(), deltas.data(), component_count, animation.step);
+        frames_since_keyframe++;
+    }
+    animation.frame_offsets.push_back(animation.data.size());
+    return animation;
+}
+
+std::size_t AnimationDecoder::frame_size(std::size_t frame) const {
+    // every frame holds at least its kind byte
+    std::size_t begin = animation.frame_offsets[frame], end = animation.frame_offsets[frame + 1];
+    if (begin >= end || end > animation.data.size()) {
+        throw std::runtime_error("draw_info: invalid animation frame offsets");
+    }
+    return end - begin;
+}
+
+bool AnimationDecoder::is_keyframe(std::size_t frame) const {
+    frame_size(frame);
+    return animation.data[animation.frame_offsets[frame]] == static_cast<unsigned char>(AnimationFrameKind::keyframe);
+}
+
+const std::vector<glm::vec3> &AnimationDecoder::decode_frame(std::size_t frame) {
+    if (frame >= animation.frame_count || animation.frame_offsets.size() != animation.frame_count + 1) {
+        throw std::runtime_error("draw_info: animation frame out of range");
+    }
+    if (frame == current_frame) {
+        return xyz_positions;
+    }
+    std::size_t first = frame;
+    if (current_frame < frame) {
+        // continue from the current frame unless a keyframe in between makes the earlier deltas pointless
+        first = current_frame + 1;
+        for (std::size_t f = frame; f > current_frame; f--) {
+            if (is_keyframe(f)) {
+                first = f;
+                break;
+            }
+        }
+    } else {
+        while (!is_keyframe(first)) {
+            if (first == 0) {
+                throw std::runtime_error("draw_info: animation does not start with a keyframe");
+            }
+            first--;
+        }
+    }
+    DRAW_INFO_PROFILE_SCOPE(decoding, (frame - first + 1) * animation.vertex_count * sizeof(glm::vec3));
+    xyz_positions.resize(animation.vertex_count);
+    for (std::size_t f = first; f <= frame; f++) {
+        apply_frame(f);
+    }
+    current_frame = frame;
+    return xyz_positions;
+}
+
+void AnimationDecoder::decode_frame(std::size_t frame, IndexedVertexPositions &target) {
+    const std::vector<glm::vec3> &positions = decode_frame(frame);
+    target.xyz_positions.resize(positions.size());
+    target.set_xyz_positions(0, positions);
+}
+
+void AnimationDecoder::apply_frame(std::size_t frame) {
+    const std::size_t size = frame_size(frame);
+    const unsigned char *data = animation.data.data() + animation.frame_offsets[frame];
+    const std::size_t component_count = animation.vertex_count * 3;
+    auto kind = static_cast<AnimationFrameKind>(data[0]);
+
+    if (kind == AnimationFrameKind::keyframe) {
+        std::size_t bytes_read = 0;
+        decode_vertices(data + 1, size - 1, bytes_read, xyz_positions.data(), animation.vertex_count,
+                        sizeof(glm::vec3));
+        return;
+    }
+    if (kind != AnimationFrameKind::delta_8 && kind != AnimationFrameKind::delta_16) {
+        throw std::runtime_error("draw_info: unknown animation frame kind");
+    }
+    std::size_t delta_size = kind == AnimationFrameKind::delta_16 ? 2 : 1;
+    if (size != 1 + component_count * delta_size) {
+        throw std::runtime_error("draw_info: truncated animation frame");
+    }
+    // widen into a flat buffer first so the accumulation below is one straight loop the compiler can vectorize
+    deltas.resize(component_count);
+    std::size_t i = 0;
+    if (kind == AnimationFrameKind::delta_8) {
+#if defined(__SSE2__)
+        // the same unpack and shift sign extension as apply_position_deltas, bytes to 16 bits
+        for (; i + 16 <= component_count; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 1 + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(deltas.data() + i),
+                             _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(deltas.data() + i + 8),
+                             _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8));
+        }
+#endif
+        for (; i < component_count; i++) {
+            deltas[i] = static_cast<std::int8_t>(data[1 + i]);
+        }
+    } else {
+#if defined(__SSE2__)
+        // x86 is little endian, so the stored deltas already are the in memory int16 values
+        for (; i + 8 <= component_count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(deltas.data() + i),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 1 + 2 * i)));
+        }
+#endif
+        for (; i < component_count; i++) {
+            deltas[i] = static_cast<std::int16_t>(data[1 + 2 * i] | (data[2 + 2 * i] << 8));
+        }
+    }
+    float *components = reinterpret_cast<float *>(xyz_positions.data());
+    apply_position_deltas(components, deltas.data(), component_count, animation.step);
+}
+
+} // namespace draw_info
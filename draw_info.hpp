@@ -2,41 +2,345 @@
 #define DRAW_INFO_HPP
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "sbpt_generated_includes.hpp"
 
+namespace draw_info {
+
+/**
+ * @brief optional counters and trace events for the operations in this file
+ *
+ * nothing is recorded unless DRAW_INFO_INSTRUMENTATION is defined when compiling draw_info.cpp (and everything that
+ * includes this header), without it the macros below expand to nothing and the functions report empty data.
+ * counters live in per thread storage and are only summed when asked for.
+ */
+namespace instrumentation {
+
+enum class Operation {
+    construction,
+    packing,
+    culling,
+    merging,
+    validation,
+    degenerate_removal,
+    overdraw_optimization,
+    encoding,
+    decoding,
+    slicing,
+    convex_hull,
+    generation,
+    rasterization,
+    stripify,
+    count
+};
+
+const char *to_string(Operation operation);
+
+struct OperationCounters {
+    std::uint64_t calls = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t nanoseconds = 0;
+};
+
+void record(Operation operation, std::uint64_t bytes, std::uint64_t start_nanoseconds, std::uint64_t nanoseconds);
+std::uint64_t now_nanoseconds();
+
+// sums the counters of every thread that has recorded anything, including threads that have exited
+std::array<OperationCounters, static_cast<std::size_t>(Operation::count)> aggregate_counters();
+// counters are only written by their own thread, call this while no instrumented work is running or a concurrent
+// record can overwrite the reset
+void reset();
+
+// trace events are only kept while tracing is enabled, each thread keeps at most max_events_per_thread
+void set_tracing_enabled(bool enabled, std::size_t max_events_per_thread = 1 << 16);
+// json in the chrome trace event format, load it in chrome://tracing or perfetto
+std::string export_chrome_trace();
+
+class ScopedTimer {
+  public:
+    ScopedTimer(Operation operation, std::uint64_t bytes)
+        : operation(operation), bytes(bytes), start(now_nanoseconds()) {}
+    ~ScopedTimer() { record(operation, bytes, start, now_nanoseconds() - start); }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    Operation operation;
+    std::uint64_t bytes;
+    std::uint64_t start;
+};
+
+} // namespace instrumentation
+
+} // namespace draw_info
+
+#ifdef DRAW_INFO_INSTRUMENTATION
+#define DRAW_INFO_CONCAT_INNER(a, b) a##b
+#define DRAW_INFO_CONCAT(a, b) DRAW_INFO_CONCAT_INNER(a, b)
+// times the rest of the enclosing scope
+#define DRAW_INFO_PROFILE_SCOPE(operation, bytes)                                                                      \
+    ::draw_info::instrumentation::ScopedTimer DRAW_INFO_CONCAT(draw_info_scoped_timer_, __LINE__)(                     \
+        ::draw_info::instrumentation::Operation::operation, static_cast<std::uint64_t>(bytes))
+// counts a call without timing it, for places where the work happens before any statement can run
+#define DRAW_INFO_PROFILE_COUNT(operation, bytes)                                                                      \
+    ::draw_info::instrumentation::record(::draw_info::instrumentation::Operation::operation,                           \
+                                         static_cast<std::uint64_t>(bytes), 0, 0)
+#else
+#define DRAW_INFO_PROFILE_SCOPE(operation, bytes) ((void)0)
+#define DRAW_INFO_PROFILE_COUNT(operation, bytes) ((void)0)
+#endif
+
+namespace draw_info {
+
+// half open range of element indices [begin, end)
+struct IndexRange {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t size() const { return end - begin; }
+};
+
+/**
+ * @brief sorted, non overlapping set of ranges that were modified since the last upload
+ *
+ * @note touching or overlapping ranges are merged as they are marked
+ */
+class DirtyRanges {
+  public:
+    void mark(std::size_t begin, std::size_t count);
+    void mark_all(std::size_t element_count);
+    // merges ranges separated by at most max_gap clean elements, fewer larger uploads are often cheaper
+    void coalesce(std::size_t max_gap);
+    void clear() { ranges.clear(); }
+    bool empty() const { return ranges.empty(); }
+    std::size_t dirty_element_count() const;
+    const std::vector<IndexRange> &get_ranges() const { return ranges; }
+    std::size_t used_heap_bytes() const { return ranges.size() * sizeof(IndexRange); }
+    std::size_t reserved_heap_bytes() const { return ranges.capacity() * sizeof(IndexRange); }
+    void shrink_to_fit() { ranges.shrink_to_fit(); }
+
+  private:
+    std::vector<IndexRange> ranges;
+};
+
+enum class BufferKind { indices, xyz_positions, normals, texture_coordinates, rgb_colors, count };
+
+/**
+ * @brief dirty ranges for each buffer of a draw info object
+ *
+ * the per buffer ranges are only allocated on the first mark, so objects that are never uploaded incrementally pay
+ * for a single pointer
+ */
+class DirtyTracker {
+  public:
+    DirtyTracker() = default;
+    DirtyTracker(const DirtyTracker &other)
+        : buffers(other.buffers ? std::make_unique<Buffers>(*other.buffers) : nullptr) {}
+    DirtyTracker(DirtyTracker &&other) noexcept = default;
+    DirtyTracker &operator=(const DirtyTracker &other) {
+        buffers = other.buffers ? std::make_unique<Buffers>(*other.buffers) : nullptr;
+        return *this;
+    }
+    DirtyTracker &operator=(DirtyTracker &&other) noexcept = default;
+
+    void mark(BufferKind kind, std::size_t begin, std::size_t count = 1) {
+        if (!buffers) {
+            buffers = std::make_unique<Buffers>();
+        }
+        (*buffers)[static_cast<std::size_t>(kind)].mark(begin, count);
+    }
+
+    // writes value to buffer[i] and marks it, the shared body of the draw info set_* functions
+    template <typename T> void set(BufferKind kind, std::vector<T> &buffer, std::size_t i, const T &value) {
+        buffer[i] = value;
+        mark(kind, i);
+    }
+    template <typename T>
+    void set(BufferKind kind, std::vector<T> &buffer, std::size_t start, const std::vector<T> &values) {
+        std::copy(values.begin(), values.end(), buffer.begin() + start);
+        mark(kind, start, values.size());
+    }
+
+    const DirtyRanges &get(BufferKind kind) const {
+        static const DirtyRanges no_ranges;
+        return buffers ? (*buffers)[static_cast<std::size_t>(kind)] : no_ranges;
+    }
+    void coalesce(std::size_t max_gap) {
+        if (buffers) {
+            for (DirtyRanges &ranges : *buffers) {
+                ranges.coalesce(max_gap);
+            }
+        }
+    }
+    void clear(BufferKind kind) {
+        if (buffers) {
+            (*buffers)[static_cast<std::size_t>(kind)].clear();
+        }
+    }
+    // keeps the allocation, an object that was marked once will likely be marked again
+    void clear() {
+        if (buffers) {
+            for (DirtyRanges &ranges : *buffers) {
+                ranges.clear();
+            }
+        }
+    }
+    bool empty() const {
+        if (buffers) {
+            for (const DirtyRanges &ranges : *buffers) {
+                if (!ranges.empty()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // the per buffer allocation counts as used only while some range is pending, shrink_to_fit frees it otherwise
+    std::size_t used_heap_bytes() const {
+        if (empty()) {
+            return 0;
+        }
+        std::size_t total = sizeof(Buffers);
+        for (const DirtyRanges &ranges : *buffers) {
+            total += ranges.used_heap_bytes();
+        }
+        return total;
+    }
+    std::size_t reserved_heap_bytes() const {
+        if (!buffers) {
+            return 0;
+        }
+        std::size_t total = sizeof(Buffers);
+        for (const DirtyRanges &ranges : *buffers) {
+            total += ranges.reserved_heap_bytes();
+        }
+        return total;
+    }
+    // frees the allocation when nothing is pending, otherwise trims the range vectors
+    void shrink_to_fit() {
+        if (empty()) {
+            buffers.reset();
+            return;
+        }
+        for (DirtyRanges &ranges : *buffers) {
+            ranges.shrink_to_fit();
+        }
+    }
+
+  private:
+    using Buffers = std::array<DirtyRanges, static_cast<std::size_t>(BufferKind::count)>;
+    std::unique_ptr<Buffers> buffers;
+};
+
+} // namespace draw_info
+
+// the set_* functions write through and record what changed in `dirty` so that renderers can upload only the
+// modified ranges, writing to the vectors directly is still allowed but then the caller has to mark `dirty` itself
+
 class IndexedVertexPositions {
   public:
     IndexedVertexPositions(std::vector<unsigned int> indices, std::vector<glm::vec3> xyz_positions)
-        : indices(indices), xyz_positions(xyz_positions) {};
+        : indices(std::move(indices)), xyz_positions(std::move(xyz_positions)) {
+        DRAW_INFO_PROFILE_COUNT(construction, this->indices.size() * sizeof(unsigned int) +
+                                                  this->xyz_positions.size() * sizeof(glm::vec3));
+    };
+    void set_index(std::size_t i, unsigned int index) { dirty.set(draw_info::BufferKind::indices, indices, i, index); }
+    void set_indices(std::size_t start, const std::vector<unsigned int> &new_indices) {
+        dirty.set(draw_info::BufferKind::indices, indices, start, new_indices);
+    }
+    void set_xyz_position(std::size_t i, const glm::vec3 &position) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, i, position);
+    }
+    void set_xyz_positions(std::size_t start, const std::vector<glm::vec3> &positions) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, start, positions);
+    }
     Transform transform;
     std::vector<unsigned int> indices;
     std::vector<glm::vec3> xyz_positions;
+    draw_info::DirtyTracker dirty;
 };
 
 class IVPSolidColor {
   public:
     IVPSolidColor(std::vector<unsigned int> indices, std::vector<glm::vec3> xyz_positions,
                   std::vector<glm::vec3> rgb_colors)
-        : indices(indices), xyz_positions(xyz_positions), rgb_colors(rgb_colors) {};
+        : indices(std::move(indices)), xyz_positions(std::move(xyz_positions)), rgb_colors(std::move(rgb_colors)) {
+        DRAW_INFO_PROFILE_COUNT(construction,
+                                this->indices.size() * sizeof(unsigned int) +
+                                    (this->xyz_positions.size() + this->rgb_colors.size()) * sizeof(glm::vec3));
+    };
+    void set_index(std::size_t i, unsigned int index) { dirty.set(draw_info::BufferKind::indices, indices, i, index); }
+    void set_indices(std::size_t start, const std::vector<unsigned int> &new_indices) {
+        dirty.set(draw_info::BufferKind::indices, indices, start, new_indices);
+    }
+    void set_xyz_position(std::size_t i, const glm::vec3 &position) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, i, position);
+    }
+    void set_xyz_positions(std::size_t start, const std::vector<glm::vec3> &positions) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, start, positions);
+    }
+    void set_rgb_color(std::size_t i, const glm::vec3 &color) {
+        dirty.set(draw_info::BufferKind::rgb_colors, rgb_colors, i, color);
+    }
+    void set_rgb_colors(std::size_t start, const std::vector<glm::vec3> &colors) {
+        dirty.set(draw_info::BufferKind::rgb_colors, rgb_colors, start, colors);
+    }
     Transform transform;
     std::vector<unsigned int> indices;
     std::vector<glm::vec3> xyz_positions;
     std::vector<glm::vec2> texture_coordinates;
     std::vector<glm::vec3> rgb_colors;
+    draw_info::DirtyTracker dirty;
 };
 
 class IVPTextured {
   public:
     IVPTextured(std::vector<unsigned int> indices, std::vector<glm::vec3> xyz_positions,
                 std::vector<glm::vec2> texture_coordinates, const std::string &texture = "")
-        : indices(indices), xyz_positions(xyz_positions), texture_coordinates(texture_coordinates), texture(texture) {};
+        : indices(std::move(indices)), xyz_positions(std::move(xyz_positions)),
+          texture_coordinates(std::move(texture_coordinates)), texture(texture) {
+        DRAW_INFO_PROFILE_COUNT(construction, this->indices.size() * sizeof(unsigned int) +
+                                                  this->xyz_positions.size() * sizeof(glm::vec3) +
+                                                  this->texture_coordinates.size() * sizeof(glm::vec2));
+    };
+    void set_index(std::size_t i, unsigned int index) { dirty.set(draw_info::BufferKind::indices, indices, i, index); }
+    void set_indices(std::size_t start, const std::vector<unsigned int> &new_indices) {
+        dirty.set(draw_info::BufferKind::indices, indices, start, new_indices);
+    }
+    void set_xyz_position(std::size_t i, const glm::vec3 &position) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, i, position);
+    }
+    void set_xyz_positions(std::size_t start, const std::vector<glm::vec3> &positions) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, start, positions);
+    }
+    void set_texture_coordinate(std::size_t i, const glm::vec2 &texture_coordinate) {
+        dirty.set(draw_info::BufferKind::texture_coordinates, texture_coordinates, i, texture_coordinate);
+    }
+    void set_texture_coordinates(std::size_t start, const std::vector<glm::vec2> &new_texture_coordinates) {
+        dirty.set(draw_info::BufferKind::texture_coordinates, texture_coordinates, start, new_texture_coordinates);
+    }
     Transform transform;
     std::vector<unsigned int> indices;
     std::vector<glm::vec3> xyz_positions;
     std::vector<glm::vec2> texture_coordinates;
     std::string texture;
+    draw_info::DirtyTracker dirty;
 };
 
 // with normals
@@ -45,14 +349,1186 @@ class IVPNTextured {
     IVPNTextured(std::vector<unsigned int> indices, std::vector<glm::vec3> xyz_positions,
                  std::vector<glm::vec3> normals, std::vector<glm::vec2> texture_coordinates,
                  const std::string &texture = "")
-        : indices(indices), xyz_positions(xyz_positions), normals(normals), texture_coordinates(texture_coordinates),
-          texture(texture) {};
+        : indices(std::move(indices)), xyz_positions(std::move(xyz_positions)), normals(std::move(normals)),
+          texture_coordinates(std::move(texture_coordinates)), texture(texture) {
+        DRAW_INFO_PROFILE_COUNT(construction,
+                                this->indices.size() * sizeof(unsigned int) +
+                                    (this->xyz_positions.size() + this->normals.size()) * sizeof(glm::vec3) +
+                                    this->texture_coordinates.size() * sizeof(glm::vec2));
+    };
+    void set_index(std::size_t i, unsigned int index) { dirty.set(draw_info::BufferKind::indices, indices, i, index); }
+    void set_indices(std::size_t start, const std::vector<unsigned int> &new_indices) {
+        dirty.set(draw_info::BufferKind::indices, indices, start, new_indices);
+    }
+    void set_xyz_position(std::size_t i, const glm::vec3 &position) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, i, position);
+    }
+    void set_xyz_positions(std::size_t start, const std::vector<glm::vec3> &positions) {
+        dirty.set(draw_info::BufferKind::xyz_positions, xyz_positions, start, positions);
+    }
+    void set_normal(std::size_t i, const glm::vec3 &normal) {
+        dirty.set(draw_info::BufferKind::normals, normals, i, normal);
+    }
+    void set_normals(std::size_t start, const std::vector<glm::vec3> &new_normals) {
+        dirty.set(draw_info::BufferKind::normals, normals, start, new_normals);
+    }
+    void set_texture_coordinate(std::size_t i, const glm::vec2 &texture_coordinate) {
+        dirty.set(draw_info::BufferKind::texture_coordinates, texture_coordinates, i, texture_coordinate);
+    }
+    void set_texture_coordinates(std::size_t start, const std::vector<glm::vec2> &new_texture_coordinates) {
+        dirty.set(draw_info::BufferKind::texture_coordinates, texture_coordinates, start, new_texture_coordinates);
+    }
     Transform transform;
     std::vector<unsigned int> indices;
     std::vector<glm::vec3> xyz_positions;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> texture_coordinates;
     std::string texture;
+    draw_info::DirtyTracker dirty;
+};
+
+namespace draw_info {
+
+/**
+ * @brief read only pointer and length, implicitly created from a std::vector so functions taking views accept vectors
+ */
+template <typename T> class ArrayView {
+  public:
+    ArrayView() = default;
+    ArrayView(const T *elements, std::size_t element_count) : elements(elements), element_count(element_count) {}
+    ArrayView(const std::vector<T> &vector) : elements(vector.data()), element_count(vector.size()) {}
+
+    const T *data() const { return elements; }
+    std::size_t size() const { return element_count; }
+    bool empty() const { return element_count == 0; }
+    const T &operator[](std::size_t i) const { return elements[i]; }
+    const T *begin() const { return elements; }
+    const T *end() const { return elements + element_count; }
+
+  private:
+    const T *elements = nullptr;
+    std::size_t element_count = 0;
+};
+
+/**
+ * @brief non owning mirrors of the draw info classes, for geometry that lives in mapped files, arenas or staging
+ * memory. every read only algorithm below takes these, and each owning class converts to its own view implicitly.
+ *
+ * @note a view is only valid while the memory it points at is, the transform may be null
+ */
+struct IndexedVertexPositionsView {
+    IndexedVertexPositionsView() = default;
+    IndexedVertexPositionsView(const IndexedVertexPositions &ivp)
+        : indices(ivp.indices), xyz_positions(ivp.xyz_positions), transform(&ivp.transform) {}
+    ArrayView<unsigned int> indices;
+    ArrayView<glm::vec3> xyz_positions;
+    const Transform *transform = nullptr;
+};
+
+struct IVPSolidColorView {
+    IVPSolidColorView() = default;
+    IVPSolidColorView(const IVPSolidColor &ivpsc)
+        : indices(ivpsc.indices), xyz_positions(ivpsc.xyz_positions), texture_coordinates(ivpsc.texture_coordinates),
+          rgb_colors(ivpsc.rgb_colors), transform(&ivpsc.transform) {}
+    ArrayView<unsigned int> indices;
+    ArrayView<glm::vec3> xyz_positions;
+    ArrayView<glm::vec2> texture_coordinates;
+    ArrayView<glm::vec3> rgb_colors;
+    const Transform *transform = nullptr;
+};
+
+struct IVPTexturedView {
+    IVPTexturedView() = default;
+    IVPTexturedView(const IVPTextured &ivpt)
+        : indices(ivpt.indices), xyz_positions(ivpt.xyz_positions), texture_coordinates(ivpt.texture_coordinates),
+          texture(ivpt.texture), transform(&ivpt.transform) {}
+    ArrayView<unsigned int> indices;
+    ArrayView<glm::vec3> xyz_positions;
+    ArrayView<glm::vec2> texture_coordinates;
+    std::string_view texture;
+    const Transform *transform = nullptr;
+};
+
+struct IVPNTexturedView {
+    IVPNTexturedView() = default;
+    IVPNTexturedView(const IVPNTextured &ivpnt)
+        : indices(ivpnt.indices), xyz_positions(ivpnt.xyz_positions), normals(ivpnt.normals),
+          texture_coordinates(ivpnt.texture_coordinates), texture(ivpnt.texture), transform(&ivpnt.transform) {}
+    ArrayView<unsigned int> indices;
+    ArrayView<glm::vec3> xyz_positions;
+    ArrayView<glm::vec3> normals;
+    ArrayView<glm::vec2> texture_coordinates;
+    std::string_view texture;
+    const Transform *transform = nullptr;
+};
+
+// 64 bit content fingerprint (xxhash64 algorithm), processes 32 bytes per round in four independent lanes
+std::uint64_t hash_bytes(const void *data, std::size_t size, std::uint64_t seed = 0);
+
+// fingerprints only cover geometry, the transform and texture are deliberately ignored so that two instances of the
+// same mesh placed differently hash the same
+std::uint64_t hash_geometry(const IndexedVertexPositionsView &ivp);
+std::uint64_t hash_geometry(const IVPSolidColorView &ivpsc);
+std::uint64_t hash_geometry(const IVPTexturedView &ivpt);
+std::uint64_t hash_geometry(const IVPNTexturedView &ivpnt);
+
+bool same_geometry(const IndexedVertexPositionsView &a, const IndexedVertexPositionsView &b);
+bool same_geometry(const IVPSolidColorView &a, const IVPSolidColorView &b);
+bool same_geometry(const IVPTexturedView &a, const IVPTexturedView &b);
+bool same_geometry(const IVPNTexturedView &a, const IVPNTexturedView &b);
+
+// number of bytes held by the geometry arrays (size, not capacity)
+std::size_t geometry_size_in_bytes(const IndexedVertexPositionsView &ivp);
+std::size_t geometry_size_in_bytes(const IVPSolidColorView &ivpsc);
+std::size_t geometry_size_in_bytes(const IVPTexturedView &ivpt);
+std::size_t geometry_size_in_bytes(const IVPNTexturedView &ivpnt);
+
+/**
+ * @brief shares one immutable copy of geometry across every instance that is byte identical
+ *
+ * @note the stored object keeps the transform and texture of the first instance that was interned, callers hold
+ * their own per instance transform/texture next to the returned pointer
+ */
+template <typename DrawInfo> class GeometryCache {
+  public:
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t bytes_saved = 0;
+    };
+
+    // pass temporaries or std::move so a miss moves the geometry into the cache instead of copying it
+    std::shared_ptr<const DrawInfo> intern(DrawInfo draw_info) {
+        std::uint64_t hash = hash_geometry(draw_info);
+        auto [begin, end] = hash_to_geometry.equal_range(hash);
+        for (auto it = begin; it != end; ++it) {
+            if (same_geometry(*it->second, draw_info)) {
+                stats.hits++;
+                stats.bytes_saved += geometry_size_in_bytes(draw_info);
+                return it->second;
+            }
+        }
+        stats.misses++;
+        auto shared = std::make_shared<const DrawInfo>(std::move(draw_info));
+        hash_to_geometry.emplace(hash, shared);
+        return shared;
+    }
+
+    // drops geometry that is only referenced by the cache itself, returns how many entries were removed
+    std::size_t collect_unused() {
+        std::size_t removed = 0;
+        for (auto it = hash_to_geometry.begin(); it != hash_to_geometry.end();) {
+            if (it->second.use_count() == 1) {
+                it = hash_to_geometry.erase(it);
+                removed++;
+            } else {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    std::size_t size() const { return hash_to_geometry.size(); }
+    const Stats &get_stats() const { return stats; }
+
+  private:
+    std::unordered_multimap<std::uint64_t, std::shared_ptr<const DrawInfo>> hash_to_geometry;
+    Stats stats;
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0);
+    float radius = 0;
+};
+
+// centered on the aabb of the positions, not minimal but cheap and stable
+BoundingSphere compute_bounding_sphere(ArrayView<glm::vec3> xyz_positions);
+
+/**
+ * @brief per instance data for instanced drawing, stored as a structure of arrays
+ *
+ * @note removal swaps the last instance into the removed slot, so instance indices are not stable across removals
+ */
+class InstanceArray {
+  public:
+    unsigned int add_instance(const glm::mat4 &model_matrix, const glm::vec4 &color = glm::vec4(1));
+    unsigned int add_instance(const Transform &transform, const glm::vec4 &color = glm::vec4(1));
+    void remove_instance(unsigned int instance_index);
+    void set_model_matrix(unsigned int instance_index, const glm::mat4 &model_matrix);
+    void set_color(unsigned int instance_index, const glm::vec4 &color);
+    void reserve(std::size_t count);
+    void clear();
+    std::size_t size() const { return model_matrices.size(); }
+
+    /**
+     * @brief tests every instance's world space bounding sphere against the frustum planes
+     *
+     * @param local_bounds the bounding sphere of the shared geometry in model space
+     * @param frustum_planes planes as (normal, d) with normals pointing into the frustum, so a point p is inside when
+     * dot(normal, p) + d >= 0
+     * @param visible_instance_indices cleared then filled with the indices of the instances that survive
+     */
+    void cull(const BoundingSphere &local_bounds, const std::array<glm::vec4, 6> &frustum_planes,
+              std::vector<unsigned int> &visible_instance_indices) const;
+
+    // interleaves the model matrix (column major) and color of each listed instance, 20 floats per instance
+    void write_instance_buffer(const std::vector<unsigned int> &instance_indices, std::vector<float> &out) const;
+    void write_instance_buffer(std::vector<float> &out) const;
+
+    static constexpr std::size_t floats_per_instance = 20;
+
+    std::vector<glm::mat4> model_matrices;
+    std::vector<glm::vec4> colors;
+};
+
+/**
+ * @brief one immutable geometry block drawn many times, each instance only stores its own transform and color
+ */
+template <typename DrawInfo> class Instanced {
+  public:
+    explicit Instanced(std::shared_ptr<const DrawInfo> geometry)
+        : geometry(std::move(geometry)), local_bounds(compute_bounding_sphere(this->geometry->xyz_positions)) {};
+
+    void cull(const std::array<glm::vec4, 6> &frustum_planes,
+              std::vector<unsigned int> &visible_instance_indices) const {
+        instances.cull(local_bounds, frustum_planes, visible_instance_indices);
+    }
+
+    const std::shared_ptr<const DrawInfo> &get_geometry() const { return geometry; }
+    const BoundingSphere &get_local_bounds() const { return local_bounds; }
+
+    InstanceArray instances;
+
+  private:
+    std::shared_ptr<const DrawInfo> geometry;
+    BoundingSphere local_bounds;
+};
+
+using MeshId = decltype(UniqueIDGenerator::generate());
+
+// the slot and generation give O(1) validated lookup, the id is globally unique and survives serialization
+struct MeshHandle {
+    unsigned int slot_index = 0;
+    unsigned int generation = 0;
+    MeshId id{};
+
+    bool operator==(const MeshHandle &other) const {
+        return slot_index == other.slot_index && generation == other.generation && id == other.id;
+    }
+    bool operator!=(const MeshHandle &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief slot map storing draw info objects densely, handles become invalid once their object is removed
+ *
+ * @note objects live contiguously in insertion order until a removal moves the last object into the hole, iterate
+ * with begin()/end() or get_dense_objects() for cache friendly traversal
+ */
+template <typename DrawInfo> class MeshRegistry {
+  public:
+    MeshHandle insert(DrawInfo draw_info) {
+        unsigned int slot_index;
+        if (free_slot_indices.empty()) {
+            slot_index = static_cast<unsigned int>(slots.size());
+            slots.push_back(Slot{});
+        } else {
+            slot_index = free_slot_indices.back();
+            free_slot_indices.pop_back();
+        }
+        Slot &slot = slots[slot_index];
+        slot.dense_index = static_cast<unsigned int>(dense_objects.size());
+        slot.occupied = true;
+
+        MeshHandle handle{slot_index, slot.generation, UniqueIDGenerator::generate()};
+        dense_objects.push_back(std::move(draw_info));
+        dense_handles.push_back(handle);
+        id_to_slot_index[handle.id] = slot_index;
+        return handle;
+    }
+
+    bool remove(const MeshHandle &handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+        Slot &slot = slots[handle.slot_index];
+        unsigned int dense_index = slot.dense_index;
+        unsigned int last_dense_index = static_cast<unsigned int>(dense_objects.size() - 1);
+        if (dense_index != last_dense_index) {
+            dense_objects[dense_index] = std::move(dense_objects[last_dense_index]);
+            dense_handles[dense_index] = dense_handles[last_dense_index];
+            slots[dense_handles[dense_index].slot_index].dense_index = dense_index;
+        }
+        dense_objects.pop_back();
+        dense_handles.pop_back();
+        id_to_slot_index.erase(handle.id);
+
+        slot.occupied = false;
+        slot.generation++;
+        free_slot_indices.push_back(handle.slot_index);
+        return true;
+    }
+
+    bool contains(const MeshHandle &handle) const {
+        return handle.slot_index < slots.size() && slots[handle.slot_index].occupied &&
+               slots[handle.slot_index].generation == handle.generation &&
+               dense_handles[slots[handle.slot_index].dense_index].id == handle.id;
+    }
+
+    // returns nullptr when the handle is stale
+    DrawInfo *get(const MeshHandle &handle) {
+        return contains(handle) ? &dense_objects[slots[handle.slot_index].dense_index] : nullptr;
+    }
+    const DrawInfo *get(const MeshHandle &handle) const {
+        return contains(handle) ? &dense_objects[slots[handle.slot_index].dense_index] : nullptr;
+    }
+
+    // for callers that only kept the id around
+    DrawInfo *get_by_id(MeshId id) {
+        auto it = id_to_slot_index.find(id);
+        return it == id_to_slot_index.end() ? nullptr : &dense_objects[slots[it->second].dense_index];
+    }
+    const DrawInfo *get_by_id(MeshId id) const {
+        auto it = id_to_slot_index.find(id);
+        return it == id_to_slot_index.end() ? nullptr : &dense_objects[slots[it->second].dense_index];
+    }
+
+    void reserve(std::size_t count) {
+        dense_objects.reserve(count);
+        dense_handles.reserve(count);
+        slots.reserve(count);
+        id_to_slot_index.reserve(count);
+    }
+
+    void clear() {
+        for (const MeshHandle &handle : dense_handles) {
+            Slot &slot = slots[handle.slot_index];
+            slot.occupied = false;
+            slot.generation++;
+            free_slot_indices.push_back(handle.slot_index);
+        }
+        dense_objects.clear();
+        dense_handles.clear();
+        id_to_slot_index.clear();
+    }
+
+    std::size_t size() const { return dense_objects.size(); }
+    bool empty() const { return dense_objects.empty(); }
+
+    // dense_objects[i] belongs to dense_handles[i]
+    std::vector<DrawInfo> &get_dense_objects() { return dense_objects; }
+    const std::vector<DrawInfo> &get_dense_objects() const { return dense_objects; }
+    const std::vector<MeshHandle> &get_dense_handles() const { return dense_handles; }
+
+    typename std::vector<DrawInfo>::iterator begin() { return dense_objects.begin(); }
+    typename std::vector<DrawInfo>::iterator end() { return dense_objects.end(); }
+    typename std::vector<DrawInfo>::const_iterator begin() const { return dense_objects.begin(); }
+    typename std::vector<DrawInfo>::const_iterator end() const { return dense_objects.end(); }
+
+  private:
+    struct Slot {
+        unsigned int dense_index = 0;
+        unsigned int generation = 0;
+        bool occupied = false;
+    };
+
+    std::vector<DrawInfo> dense_objects;
+    std::vector<MeshHandle> dense_handles;
+    std::vector<Slot> slots;
+    std::vector<unsigned int> free_slot_indices;
+    std::unordered_map<MeshId, unsigned int> id_to_slot_index;
+};
+
+// interleaved vertex layouts used when packing for upload:
+// IndexedVertexPositions: xyz, IVPSolidColor: xyz rgb, IVPTextured: xyz uv, IVPNTextured: xyz normal uv
+std::size_t floats_per_packed_vertex(const IndexedVertexPositionsView &ivp);
+std::size_t floats_per_packed_vertex(const IVPSolidColorView &ivpsc);
+std::size_t floats_per_packed_vertex(const IVPTexturedView &ivpt);
+std::size_t floats_per_packed_vertex(const IVPNTexturedView &ivpnt);
+
+// out must have room for xyz_positions.size() * floats_per_packed_vertex floats
+void pack_vertices(const IndexedVertexPositionsView &ivp, float *out);
+void pack_vertices(const IVPSolidColorView &ivpsc, float *out);
+void pack_vertices(const IVPTexturedView &ivpt, float *out);
+void pack_vertices(const IVPNTexturedView &ivpnt, float *out);
+
+/**
+ * @brief fixed set of persistent staging buffers that meshes are packed into before upload
+ *
+ * the producer writes into the next slot whose fence the consumer has passed and never waits, if no slot is free the
+ * write is dropped and counted as a stall so the caller can retry next frame. the consumer (normally the gpu upload
+ * code, anything headless works too) takes submitted slots in order and releases them once it is done with them.
+ *
+ * @note one producer thread and one consumer thread may use the ring concurrently
+ */
+class StagingRing {
+  public:
+    struct Slot {
+        std::vector<unsigned char> bytes;
+        std::size_t vertex_bytes = 0;
+        std::size_t index_bytes = 0;
+        std::size_t vertex_count = 0;
+        std::size_t index_count = 0;
+        std::uint64_t fence = 0;
+    };
+
+    struct Stats {
+        std::size_t slots_submitted = 0;
+        std::size_t slots_consumed = 0;
+        std::size_t bytes_submitted = 0;
+        std::size_t stalls = 0;
+        std::size_t oversized_rejections = 0;
+        double seconds_elapsed = 0;
+        double bytes_per_second() const { return seconds_elapsed > 0 ? bytes_submitted / seconds_elapsed : 0; }
+    };
+
+    // throws std::runtime_error when slot_count is 0
+    explicit StagingRing(std::size_t slot_count = 3, std::size_t slot_capacity_in_bytes = 1 << 20);
+
+    // producer side, packed vertices are followed by the indices in the slot's bytes
+    template <typename DrawInfo> bool try_write(const DrawInfo &draw_info) {
+        std::size_t vertex_bytes = draw_info.xyz_positions.size() * floats_per_packed_vertex(draw_info) * sizeof(float);
+        std::size_t index_bytes = draw_info.indices.size() * sizeof(unsigned int);
+        if (vertex_bytes + index_bytes > slot_capacity_in_bytes) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.oversized_rejections++;
+            return false;
+        }
+        Slot *slot = try_acquire();
+        if (slot == nullptr) {
+            return false;
+        }
+        pack_vertices(draw_info, reinterpret_cast<float *>(slot->bytes.data()));
+        if (index_bytes > 0) {
+            std::memcpy(slot->bytes.data() + vertex_bytes, draw_info.indices.data(), index_bytes);
+        }
+        slot->vertex_bytes = vertex_bytes;
+        slot->index_bytes = index_bytes;
+        slot->vertex_count = draw_info.xyz_positions.size();
+        slot->index_count = draw_info.indices.size();
+        submit();
+        return true;
+    }
+
+    // lower level producer api for callers writing their own layouts, returns nullptr and counts a stall when full.
+    // submit throws std::runtime_error unless a slot was acquired since the last submit
+    Slot *try_acquire();
+    void submit();
+
+    // consumer side, returns nullptr when nothing has been submitted. release throws std::runtime_error unless a slot
+    // was consumed since the last release
+    const Slot *try_consume();
+    void release();
+
+    std::uint64_t get_completed_fence() const;
+    std::size_t get_slot_count() const { return slots.size(); }
+    std::size_t get_slot_capacity_in_bytes() const { return slot_capacity_in_bytes; }
+    Stats get_stats() const;
+
+  private:
+    enum class SlotState { free, writing, submitted, consuming };
+
+    std::vector<Slot> slots;
+    std::vector<SlotState> slot_states;
+    std::size_t slot_capacity_in_bytes;
+    std::size_t producer_index = 0;
+    std::size_t consumer_index = 0;
+    std::uint64_t next_fence = 1;
+    std::uint64_t completed_fence = 0;
+    Stats stats;
+    std::chrono::steady_clock::time_point creation_time;
+    mutable std::mutex mutex;
+};
+
+struct ValidationReport {
+    bool index_count_multiple_of_three = true;
+    std::size_t out_of_range_indices = 0;
+    unsigned int max_index = 0;
+    // true when every per vertex attribute array has as many elements as xyz_positions
+    bool attribute_sizes_match = true;
+    std::size_t non_finite_positions = 0;
+    std::size_t degenerate_triangles = 0;
+    // only counted when ValidationOptions::check_duplicate_triangles is set
+    std::size_t duplicate_triangles = 0;
+
+    bool is_valid() const {
+        return index_count_multiple_of_three && out_of_range_indices == 0 && attribute_sizes_match &&
+               non_finite_positions == 0;
+    }
+    // degenerate and duplicate triangles render fine, they are only wasted work
+    bool is_clean() const { return is_valid() && degenerate_triangles == 0 && duplicate_triangles == 0; }
+};
+
+struct ValidationOptions {
+    // duplicate detection allocates and sorts the triangles, so it is opt in to keep the default a streaming pass
+    bool check_duplicate_triangles = false;
+};
+
+/**
+ * @brief checks that a mesh can be drawn safely, index range checks and nan checks are branch free passes over the
+ * raw arrays so the compiler vectorizes them
+ *
+ * @note out of range triangles are not checked for being degenerate or duplicates
+ */
+ValidationReport validate(const IndexedVertexPositionsView &ivp, const ValidationOptions &options = {});
+ValidationReport validate(const IVPSolidColorView &ivpsc, const ValidationOptions &options = {});
+ValidationReport validate(const IVPTexturedView &ivpt, const ValidationOptions &options = {});
+ValidationReport validate(const IVPNTexturedView &ivpnt, const ValidationOptions &options = {});
+
+/**
+ * @brief removes triangles that cannot produce fragments, then drops the vertices no triangle uses any more
+ *
+ * a triangle is removed when two of its indices are equal, when any index is out of range, or when its area is at
+ * most area_epsilon
+ *
+ * @return the number of triangles removed
+ */
+std::size_t remove_degenerate_triangles(IndexedVertexPositions &ivp, float area_epsilon = 0);
+std::size_t remove_degenerate_triangles(IVPSolidColor &ivpsc, float area_epsilon = 0);
+std::size_t remove_degenerate_triangles(IVPTextured &ivpt, float area_epsilon = 0);
+std::size_t remove_degenerate_triangles(IVPNTextured &ivpnt, float area_epsilon = 0);
+
+/**
+ * @brief removes vertices that are not referenced by any index, keeping the relative order of the rest
+ *
+ * empty attributes are left empty, every other attribute is compacted alongside the positions
+ *
+ * @note throws std::runtime_error if an index is out of range or a non empty attribute's size differs from the
+ * vertex count, the object is left unchanged then
+ * @return the number of vertices removed
+ */
+std::size_t compact_unused_vertices(IndexedVertexPositions &ivp);
+std::size_t compact_unused_vertices(IVPSolidColor &ivpsc);
+std::size_t compact_unused_vertices(IVPTextured &ivpt);
+std::size_t compact_unused_vertices(IVPNTextured &ivpnt);
+
+// average cache miss ratio, the number of vertex shader invocations per triangle with a fifo post transform cache
+float compute_acmr(ArrayView<unsigned int> indices, std::size_t vertex_count, unsigned int cache_size = 16);
+
+struct OverdrawStatistics {
+    std::size_t pixels_covered = 0;
+    std::size_t pixels_shaded = 0;
+    // shaded / covered, 1 means every covered pixel was shaded exactly once
+    float overdraw = 0;
+};
+
+/**
+ * @brief estimates overdraw by rasterizing the triangles in index order with a depth test from the six axis
+ * directions, this is view independent in the same way as the optimizer below
+ */
+OverdrawStatistics estimate_overdraw(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                                     unsigned int resolution = 256);
+
+/**
+ * @brief reorders triangle clusters so that outward facing clusters far from the mesh center are drawn first, which
+ * lets them occlude the rest of the mesh from most viewpoints
+ *
+ * clusters are split only where the existing order already restarts the vertex cache (a triangle whose three vertices
+ * all miss) so the vertex cache efficiency of the input order is mostly preserved, run this after a vertex cache
+ * optimization
+ */
+void optimize_overdraw(std::vector<unsigned int> &indices, ArrayView<glm::vec3> xyz_positions,
+                       unsigned int cache_size = 16);
+void optimize_overdraw(IndexedVertexPositions &ivp, unsigned int cache_size = 16);
+void optimize_overdraw(IVPSolidColor &ivpsc, unsigned int cache_size = 16);
+void optimize_overdraw(IVPTextured &ivpt, unsigned int cache_size = 16);
+void optimize_overdraw(IVPNTextured &ivpnt, unsigned int cache_size = 16);
+
+/**
+ * @brief lossless index codec, each index is stored as the zigzag varint of its delta to the previous index
+ *
+ * meshes with any locality (which is all of them after vertex cache optimization) end up at 1-2 bytes per index
+ */
+std::vector<unsigned char> encode_indices(ArrayView<unsigned int> indices);
+// throws std::runtime_error on truncated or malformed input
+std::vector<unsigned int> decode_indices(const unsigned char *data, std::size_t size, std::size_t &bytes_read);
+
+/**
+ * @brief lossless vertex codec in the style of meshoptimizer's vertex codec
+ *
+ * vertices are processed in blocks of 256, within a block each byte of the vertex is delta coded against the same
+ * byte of the previous vertex and the deltas are transposed into one stream per byte. every 16 deltas are then bit
+ * packed with 0, 2, 4 or 8 bits each, chosen per group and recorded in a 2 bit header. smooth attributes produce mostly
+ * tiny deltas in the high bytes, which pack very well and decode with simple shifts.
+ */
+std::vector<unsigned char> encode_vertices(const void *vertices, std::size_t vertex_count, std::size_t vertex_size);
+// throws std::runtime_error on truncated or malformed input
+void decode_vertices(const unsigned char *data, std::size_t size, std::size_t &bytes_read, void *vertices,
+                     std::size_t vertex_count, std::size_t vertex_size);
+
+/**
+ * @brief binary mesh format, a small header (magic, class, counts, texture) followed by the encoded index and
+ * attribute streams, the transform is not stored
+ */
+std::vector<unsigned char> encode_mesh(const IndexedVertexPositionsView &ivp);
+std::vector<unsigned char> encode_mesh(const IVPSolidColorView &ivpsc);
+std::vector<unsigned char> encode_mesh(const IVPTexturedView &ivpt);
+std::vector<unsigned char> encode_mesh(const IVPNTexturedView &ivpnt);
+
+// throws std::runtime_error if the data is malformed or was encoded from a different class
+template <typename DrawInfo> DrawInfo decode_mesh(const std::vector<unsigned char> &data);
+template <> IndexedVertexPositions decode_mesh<IndexedVertexPositions>(const std::vector<unsigned char> &data);
+template <> IVPSolidColor decode_mesh<IVPSolidColor>(const std::vector<unsigned char> &data);
+template <> IVPTextured decode_mesh<IVPTextured>(const std::vector<unsigned char> &data);
+template <> IVPNTextured decode_mesh<IVPNTextured>(const std::vector<unsigned char> &data);
+
+// colors are clamped to [0, 1] and rounded to nearest, rgba8 is packed little endian as r | g << 8 | b << 16 | a << 24
+// with a = 255
+void pack_colors_rgba8(ArrayView<glm::vec3> rgb_colors, std::vector<std::uint32_t> &out);
+void pack_colors_rgb565(ArrayView<glm::vec3> rgb_colors, std::vector<std::uint16_t> &out);
+void unpack_colors_rgba8(const std::vector<std::uint32_t> &packed, std::vector<glm::vec3> &out);
+void unpack_colors_rgb565(const std::vector<std::uint16_t> &packed, std::vector<glm::vec3> &out);
+
+// true when every color is exactly equal to the first one, which is then written to uniform_color
+bool has_uniform_color(ArrayView<glm::vec3> rgb_colors, glm::vec3 &uniform_color);
+
+enum class ColorFormat { uniform, rgba8, rgb565, rgb32f };
+
+/**
+ * @brief compact storage for the colors of an IVPSolidColor, from 12 bytes per vertex down to 4, 2 or a single
+ * constant for the whole mesh
+ */
+struct PackedColors {
+    ColorFormat format = ColorFormat::rgb32f;
+    glm::vec3 uniform_color = glm::vec3(0);
+    std::vector<std::uint32_t> rgba8;
+    std::vector<std::uint16_t> rgb565;
+    std::vector<glm::vec3> rgb32f;
+
+    std::size_t size_in_bytes() const;
+    void unpack(std::vector<glm::vec3> &rgb_colors, std::size_t vertex_count) const;
+};
+
+// uses the uniform format whenever the colors allow it, otherwise the requested format
+PackedColors compact_colors(const IVPSolidColorView &ivpsc, ColorFormat format = ColorFormat::rgba8);
+
+// interleaved xyz floats followed by one rgba8 color, 16 bytes per vertex instead of the 24 of pack_vertices
+void pack_vertices_rgba8(const IVPSolidColorView &ivpsc, void *out);
+
+/**
+ * @brief procedural primitives written straight into an existing IVPNTextured
+ *
+ * the output's arrays are resized to the exact counts and filled in place, so calling a generator again on the same
+ * object (or on one whose vectors were reserved with the *_counts functions below) does not allocate. all primitives
+ * are centered on the origin with +y up and counter clockwise front faces, the transform and texture are left as is.
+ */
+struct PrimitiveCounts {
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+};
+
+PrimitiveCounts box_counts();
+PrimitiveCounts grid_counts(unsigned int segments_x, unsigned int segments_z);
+PrimitiveCounts uv_sphere_counts(unsigned int slices, unsigned int stacks);
+PrimitiveCounts cylinder_counts(unsigned int slices, bool capped = true);
+PrimitiveCounts capsule_counts(unsigned int slices, unsigned int stacks_per_hemisphere);
+
+void generate_box(IVPNTextured &out, const glm::vec3 &size = glm::vec3(1));
+// a grid in the xz plane, segment counts of 0 are treated as 1
+void generate_grid(IVPNTextured &out, float width, float depth, unsigned int segments_x, unsigned int segments_z);
+// slices >= 3, stacks >= 2
+void generate_uv_sphere(IVPNTextured &out, float radius, unsigned int slices, unsigned int stacks);
+// slices >= 3
+void generate_cylinder(IVPNTextured &out, float radius, float height, unsigned int slices, bool capped = true);
+// height is the length of the cylindrical part, slices >= 3, stacks_per_hemisphere >= 1
+void generate_capsule(IVPNTextured &out, float radius, float height, unsigned int slices,
+                      unsigned int stacks_per_hemisphere);
+
+/**
+ * @brief concatenates meshes into one, indices are rebased onto the merged vertex arrays
+ *
+ * the output is sized in a first pass and then every source is copied into its own region in parallel, the copy is
+ * split into tasks of about equal index and vertex bytes so one large source does not hold up the rest. when
+ * apply_transforms is set each source's transform is baked into its positions (and normals) and the result has an
+ * identity transform, otherwise the transforms are ignored. optional attributes present on only some of the sources
+ * (texture coordinates of IVPSolidColor) are filled with zeros for the others. the texture of the first source is
+ * used for the textured classes, merging meshes with different textures is left to the caller (atlas first).
+ *
+ * @note sources are views so geometry outside the owning classes can be merged too, a view without a transform is
+ * treated as already being in world space. the vector overloads of the owning classes forward to these
+ */
+IndexedVertexPositions merge(ArrayView<IndexedVertexPositionsView> sources, bool apply_transforms = false);
+IVPSolidColor merge(ArrayView<IVPSolidColorView> sources, bool apply_transforms = false);
+IVPTextured merge(ArrayView<IVPTexturedView> sources, bool apply_transforms = false);
+IVPNTextured merge(ArrayView<IVPNTexturedView> sources, bool apply_transforms = false);
+IndexedVertexPositions merge(const std::vector<IndexedVertexPositions> &sources, bool apply_transforms = false);
+IVPSolidColor merge(const std::vector<IVPSolidColor> &sources, bool apply_transforms = false);
+IVPTextured merge(const std::vector<IVPTextured> &sources, bool apply_transforms = false);
+IVPNTextured merge(const std::vector<IVPNTextured> &sources, bool apply_transforms = false);
+
+struct SliceResult {
+    // the side where dot(plane.xyz, p) + plane.w > 0, vertices on the plane end up in both pieces
+    IVPNTextured above;
+    IVPNTextured below;
+};
+
+/**
+ * @brief cuts a mesh in two along a plane given in model space as (normal, d)
+ *
+ * triangles crossing the plane are split, new vertices interpolate position, normal and texture coordinates and are
+ * shared between the triangles on either side of an edge so the pieces stay watertight along the cut. vertices within
+ * a small tolerance of the plane (relative to the farthest vertex) count as lying on it, they are never split and are
+ * copied to both pieces, so slicing through existing vertices does not produce slivers. when cap is set
+ * each closed cut loop is filled with a fan around its centroid (correct for convex and star shaped cross sections),
+ * cap vertices get the plane normal and texture coordinates from a planar projection. runs in two passes over the
+ * triangles plus one over the cut edges, cut points are deduplicated through a sorted edge key list.
+ */
+SliceResult slice(const IVPNTexturedView &ivpnt, const glm::vec4 &plane, bool cap = false);
+
+// keeps only the part of the mesh above the plane
+IVPNTextured clip(const IVPNTexturedView &ivpnt, const glm::vec4 &plane, bool cap = false);
+
+/**
+ * @brief convex hull of a point set using quickhull
+ *
+ * the result only contains the hull vertices, with outward facing counter clockwise triangles. when max_vertices is
+ * non zero the hull stops growing once it has that many vertices, since quickhull always adds the point farthest
+ * outside the current hull this gives a good (slightly shrunk) collision proxy. degenerate inputs (fewer than four non
+ * coplanar points) produce an empty result. each added point only touches the faces it can see, so the cost follows
+ * the number of hull vertices rather than faces times points, dense inputs where every point ends up on the hull
+ * (a finely tessellated sphere) stay practical.
+ */
+IndexedVertexPositions compute_convex_hull(ArrayView<glm::vec3> xyz_positions, unsigned int max_vertices = 0);
+IndexedVertexPositions compute_convex_hull(const IndexedVertexPositionsView &ivp, unsigned int max_vertices = 0);
+
+// hulls for many meshes at once, spread across hardware threads, results are in the same order as the input
+std::vector<IndexedVertexPositions> compute_convex_hulls(ArrayView<IndexedVertexPositionsView> meshes,
+                                                         unsigned int max_vertices = 0);
+std::vector<IndexedVertexPositions> compute_convex_hulls(const std::vector<IndexedVertexPositions> &meshes,
+                                                         unsigned int max_vertices = 0);
+
+/**
+ * @brief uniform grid over a mesh's vertices and triangles for proximity queries
+ *
+ * built with a counting sort, so each cell's items are contiguous in one array (no per cell allocations). cells are
+ * hashed into a fixed table, so huge or sparse meshes do not need a dense grid. queries write into caller owned
+ * vectors which are cleared first, reuse them across queries to avoid allocating.
+ *
+ * @note positions and indices are copied at build time, the grid does not reference the mesh afterwards
+ * @note queries are not thread safe, they share scratch state used to report each item once
+ */
+class SpatialGrid {
+  public:
+    // cell_size <= 0 picks a size giving roughly two vertices per cell
+    SpatialGrid(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions, float cell_size = 0);
+    template <typename DrawInfo>
+    explicit SpatialGrid(const DrawInfo &draw_info, float cell_size = 0)
+        : SpatialGrid(draw_info.indices, draw_info.xyz_positions, cell_size) {}
+
+    // returns false when there are no vertices within max_distance, which may be infinite to search the whole mesh
+    bool find_nearest_vertex(const glm::vec3 &point, float max_distance, unsigned int &vertex_index) const;
+    void find_vertices_in_radius(const glm::vec3 &center, float radius, std::vector<unsigned int> &out) const;
+    void find_vertices_in_box(const glm::vec3 &min, const glm::vec3 &max, std::vector<unsigned int> &out) const;
+    // triangles whose bounding box overlaps the query box, out holds triangle indices (first index / 3)
+    void find_triangles_in_box(const glm::vec3 &min, const glm::vec3 &max, std::vector<unsigned int> &out) const;
+
+    float get_cell_size() const { return cell_size; }
+
+  private:
+    std::size_t cell_hash(int x, int y, int z) const;
+    int cell_coordinate(float v) const;
+    glm::ivec3 cell_of(const glm::vec3 &p) const;
+    std::uint32_t next_query_stamp() const;
+    template <typename Visit> void for_each_cell_item(const std::vector<unsigned int> &cell_starts,
+                                                      const std::vector<unsigned int> &items, const glm::vec3 &min,
+                                                      const glm::vec3 &max, Visit visit) const;
+
+    std::vector<glm::vec3> xyz_positions;
+    std::vector<unsigned int> indices;
+    float cell_size;
+    float inverse_cell_size;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+    std::size_t table_size;
+    // cell_starts[h] .. cell_starts[h + 1] is the range in the item array for hash bucket h
+    std::vector<unsigned int> vertex_cell_starts;
+    std::vector<unsigned int> vertex_items;
+    std::vector<unsigned int> triangle_cell_starts;
+    std::vector<unsigned int> triangle_items;
+    // triangles spanning too many cells to insert into each, every triangle query tests them directly
+    std::vector<unsigned int> oversized_triangles;
+    // several cells of one query can share a bucket and triangles span several cells, items are reported once per
+    // query by stamping them with the query number
+    mutable std::vector<std::uint32_t> vertex_query_stamps;
+    mutable std::vector<std::uint32_t> triangle_query_stamps;
+    mutable std::uint32_t query_stamp = 0;
+};
+
+struct AttributeFootprint {
+    std::size_t used_bytes = 0;
+    std::size_t reserved_bytes = 0;
+};
+
+/**
+ * @brief where the memory of draw info objects goes, add reports together for totals
+ */
+struct MemoryFootprint {
+    std::size_t object_count = 0;
+    // sizeof the objects themselves, vector and string headers and the transform
+    std::size_t object_bytes = 0;
+    std::array<AttributeFootprint, static_cast<std::size_t>(BufferKind::count)> attributes;
+    // bytes that would be saved by storing indices in the narrowest type holding the largest index (8 or 16 bit)
+    std::size_t index_width_waste_bytes = 0;
+    // heap memory of texture names too long for the small string buffer
+    std::size_t texture_heap_bytes = 0;
+    // the lazily allocated dirty range buffers, used while ranges are pending and reserved until shrink_to_fit
+    AttributeFootprint dirty_tracker;
+
+    const AttributeFootprint &get(BufferKind kind) const { return attributes[static_cast<std::size_t>(kind)]; }
+    std::size_t used_bytes() const;
+    std::size_t reserved_bytes() const;
+    // capacity that was allocated but holds no elements, what shrink_to_fit gives back
+    std::size_t slack_bytes() const { return reserved_bytes() - used_bytes(); }
+    MemoryFootprint &operator+=(const MemoryFootprint &other);
+};
+
+MemoryFootprint compute_footprint(const IndexedVertexPositions &ivp);
+MemoryFootprint compute_footprint(const IVPSolidColor &ivpsc);
+MemoryFootprint compute_footprint(const IVPTextured &ivpt);
+MemoryFootprint compute_footprint(const IVPNTextured &ivpnt);
+
+// releases unused capacity of every array (and the texture name), and the dirty tracker if no ranges are pending
+void shrink_to_fit(IndexedVertexPositions &ivp);
+void shrink_to_fit(IVPSolidColor &ivpsc);
+void shrink_to_fit(IVPTextured &ivpt);
+void shrink_to_fit(IVPNTextured &ivpnt);
+
+template <typename DrawInfo> MemoryFootprint compute_footprint(const MeshRegistry<DrawInfo> &registry) {
+    MemoryFootprint total;
+    for (const DrawInfo &draw_info : registry) {
+        total += compute_footprint(draw_info);
+    }
+    return total;
+}
+
+// returns the number of bytes released
+template <typename DrawInfo> std::size_t shrink_to_fit(MeshRegistry<DrawInfo> &registry) {
+    std::size_t released = 0;
+    for (DrawInfo &draw_info : registry) {
+        std::size_t before = compute_footprint(draw_info).reserved_bytes();
+        shrink_to_fit(draw_info);
+        released += before - compute_footprint(draw_info).reserved_bytes();
+    }
+    return released;
+}
+
+// area weighted vertex normals, out is resized to the vertex count, vertices used by no triangle get (0, 1, 0)
+void compute_vertex_normals(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions,
+                            std::vector<glm::vec3> &out);
+
+/**
+ * @brief conversions between the draw info classes
+ *
+ * the source is taken by value, pass it with std::move to have the shared arrays (and the transform) moved over
+ * instead of copied. attributes the target needs but the source lacks are computed in the same call: normals from
+ * the triangles, texture coordinates as (0, 0) and colors from the given color.
+ */
+IndexedVertexPositions to_indexed_vertex_positions(IVPSolidColor ivpsc);
+IndexedVertexPositions to_indexed_vertex_positions(IVPTextured ivpt);
+IndexedVertexPositions to_indexed_vertex_positions(IVPNTextured ivpnt);
+
+IVPSolidColor to_ivp_solid_color(IndexedVertexPositions ivp, const glm::vec3 &color = glm::vec3(1));
+IVPSolidColor to_ivp_solid_color(IVPTextured ivpt, const glm::vec3 &color = glm::vec3(1));
+IVPSolidColor to_ivp_solid_color(IVPNTextured ivpnt, const glm::vec3 &color = glm::vec3(1));
+
+IVPTextured to_ivp_textured(IndexedVertexPositions ivp, const std::string &texture = "");
+IVPTextured to_ivp_textured(IVPNTextured ivpnt);
+
+IVPNTextured to_ivpn_textured(IndexedVertexPositions ivp, const std::string &texture = "");
+IVPNTextured to_ivpn_textured(IVPTextured ivpt);
+
+/**
+ * @brief runs body(task, worker) for every task in [0, task_count) on thread_count threads (0 means one per hardware
+ * thread), each worker owns a deque of tasks and steals from the others once its own runs dry, so uneven task costs
+ * still balance out. returns once every task has finished.
+ *
+ * @note the calling thread is worker 0 and the others come from a pool that persists between calls, so short parallel
+ * sections do not pay for thread creation. a call made from inside a task runs its tasks inline on that worker
+ */
+void run_work_stealing(std::size_t task_count, unsigned int thread_count,
+                       const std::function<void(std::size_t task, unsigned int worker)> &body);
+
+// counts bytes that are loaded but not yet stored, new work waits while the count is at or over the limit
+class InFlightBudget {
+  public:
+    explicit InFlightBudget(std::size_t max_bytes) : max_bytes(max_bytes) {}
+    void wait_for_room();
+    void add(std::size_t bytes);
+    void remove(std::size_t bytes);
+    std::size_t get_peak_bytes() const;
+
+  private:
+    std::size_t max_bytes;
+    std::size_t bytes = 0;
+    std::size_t peak_bytes = 0;
+    mutable std::mutex mutex;
+    std::condition_variable room_available;
+};
+
+/**
+ * @brief applies a configurable list of stages to many meshes in parallel, every mesh goes through all stages in
+ * order on one worker, different meshes run concurrently
+ *
+ * @note with a byte limit a worker does not load its next mesh while the meshes being processed exceed the limit, so
+ * memory stays under the limit plus one mesh per worker
+ */
+template <typename DrawInfo> class MeshPipeline {
+  public:
+    using Stage = std::function<void(DrawInfo &)>;
+
+    struct StageStatistics {
+        std::string name;
+        std::uint64_t nanoseconds = 0; // summed across workers
+        std::size_t meshes = 0;
+    };
+
+    struct Statistics {
+        std::vector<StageStatistics> stages;
+        std::size_t meshes_processed = 0;
+        std::size_t peak_bytes_in_flight = 0;
+        double seconds_elapsed = 0;
+    };
+
+    MeshPipeline &add_stage(std::string name, Stage stage) {
+        stage_names.push_back(std::move(name));
+        stages.push_back(std::move(stage));
+        return *this;
+    }
+
+    void set_thread_count(unsigned int count) { thread_count = count; }
+    // 0 means unlimited
+    void set_max_bytes_in_flight(std::size_t bytes) { max_bytes_in_flight = bytes; }
+
+    // streaming form, load(i) produces mesh i and store(i, mesh) receives it after the last stage
+    Statistics run(std::size_t mesh_count, const std::function<DrawInfo(std::size_t)> &load,
+                   const std::function<void(std::size_t, DrawInfo &&)> &store) const {
+        auto start = std::chrono::steady_clock::now();
+        unsigned int workers = thread_count == 0 ? std::max(1u, std::thread::hardware_concurrency()) : thread_count;
+        // per worker timings so workers never share a counter
+        std::vector<std::vector<std::uint64_t>> worker_nanoseconds(workers, std::vector<std::uint64_t>(stages.size()));
+        InFlightBudget budget(max_bytes_in_flight == 0 ? std::numeric_limits<std::size_t>::max() : max_bytes_in_flight);
+
+        run_work_stealing(mesh_count, workers, [&](std::size_t mesh_index, unsigned int worker) {
+            budget.wait_for_room();
+            DrawInfo mesh = load(mesh_index);
+            std::size_t bytes = geometry_size_in_bytes(mesh);
+            budget.add(bytes);
+            for (std::size_t s = 0; s < stages.size(); s++) {
+                auto stage_start = std::chrono::steady_clock::now();
+                stages[s](mesh);
+                worker_nanoseconds[worker][s] += static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                         stage_start)
+                        .count());
+            }
+            store(mesh_index, std::move(mesh));
+            budget.remove(bytes);
+        });
+
+        Statistics statistics;
+        statistics.meshes_processed = mesh_count;
+        statistics.peak_bytes_in_flight = budget.get_peak_bytes();
+        for (std::size_t s = 0; s < stages.size(); s++) {
+            StageStatistics stage{stage_names[s], 0, mesh_count};
+            for (const auto &per_worker : worker_nanoseconds) {
+                stage.nanoseconds += per_worker[s];
+            }
+            statistics.stages.push_back(std::move(stage));
+        }
+        statistics.seconds_elapsed =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return statistics;
+    }
+
+    // in place form, meshes are moved out of the vector for processing and back afterwards
+    Statistics run(std::vector<DrawInfo> &meshes) const {
+        return run(
+            meshes.size(), [&](std::size_t i) { return std::move(meshes[i]); },
+            [&](std::size_t i, DrawInfo &&mesh) { meshes[i] = std::move(mesh); });
+    }
+
+  private:
+    std::vector<std::string> stage_names;
+    std::vector<Stage> stages;
+    unsigned int thread_count = 0;
+    std::size_t max_bytes_in_flight = 0;
 };
 
+/**
+ * @brief cpu depth buffer for occlusion culling and headless rendering tests
+ *
+ * occluders are projected with the view projection matrix times their transform, clipped against the near plane
+ * (z >= -w, opengl clip space), binned into screen tiles and rasterized one tile per thread. depth is the window space
+ * depth in [0, 1], smaller is closer, and is cleared to 1. after drawing the occluders call build_hierarchy, then test
+ * bounds with is_visible, which compares the nearest depth of the projected box against a max depth pyramid.
+ *
+ * @note both windings are drawn, occluders are usually closed meshes so this costs little and avoids missing holes
+ * @note is_visible is conservative, anything that crosses the near plane counts as visible
+ */
+class OcclusionBuffer {
+  public:
+    OcclusionBuffer(unsigned int width, unsigned int height);
+
+    void clear();
+    void set_view_projection(const glm::mat4 &view_projection) { this->view_projection = view_projection; }
+
+    // uses the view's transform when it has one
+    void draw(IndexedVertexPositionsView occluder);
+    void draw(ArrayView<unsigned int> indices, ArrayView<glm::vec3> xyz_positions, const glm::mat4 &model_matrix);
+
+    void build_hierarchy();
+
+    bool is_visible(const glm::vec3 &local_min, const glm::vec3 &local_max, const glm::mat4 &model_matrix) const;
+    bool is_visible(IndexedVertexPositionsView object) const;
+
+    unsigned int get_width() const { return width; }
+    unsigned int get_height() const { return height; }
+    // row major, row 0 is the bottom of the screen like gl window coordinates
+    const std::vector<float> &get_depth() const { return depth; }
+
+  private:
+    unsigned int width;
+    unsigned int height;
+    glm::mat4 view_projection = glm::mat4(1);
+    std::vector<float> depth;
+    // level 0 is depth itself, each level above halves the resolution and keeps the farthest depth
+    std::vector<std::vector<float>> max_depth_levels;
+};
+
+struct PickResult {
+    bool hit = false;
+    std::size_t object = 0;   // index into the objects passed to render
+    std::size_t triangle = 0; // triangle number within that object, indices[3 * triangle] is its first index
+    float depth = 1;
+};
+
+/**
+ * @brief cpu id buffer for picking, renders which object and triangle is frontmost at every pixel
+ *
+ * rendering uses the same clipping and tile parallel rasterizer as OcclusionBuffer, after one render every pick is a
+ * lookup. pixel coordinates are in buffer resolution with y up, scale mouse coordinates to the buffer size first.
+ */
+class PickingBuffer {
+  public:
+    PickingBuffer(unsigned int width, unsigned int height);
+
+    void set_view_projection(const glm::mat4 &view_projection) { this->view_projection = view_projection; }
+
+    // each view's transform is applied when it has one
+    void render(const std::vector<IndexedVertexPositionsView> &objects);
+
+    template <typename DrawInfo> void render(const std::vector<DrawInfo> &objects) {
+        std::vector<IndexedVertexPositionsView> views(objects.size());
+        for (std::size_t i = 0; i < objects.size(); i++) {
+            views[i].indices = objects[i].indices;
+            views[i].xyz_positions = objects[i].xyz_positions;
+            views[i].transform = &objects[i].transform;
+        }
+        render(views);
+    }
+
+    PickResult pick(unsigned int x, unsigned int y) const;
+
+    unsigned int get_width() const { return width; }
+    unsigned int get_height() const { return height; }
+
+  private:
+    static constexpr std::uint32_t no_object = std::numeric_limits<std::uint32_t>::max();
+
+    unsigned int width;
+    unsigned int height;
+    glm::mat4 view_projection = glm::mat4(1);
+    std::vector<float> depth;
+    std::vector<std::uint32_t> object_ids;
+    std::vector<std::uint32_t> triangle_ids;
+};
+
+constexpr unsigned int primitive_restart_index = std::numeric_limits<unsigned int>::max();
+
+struct StripifyResult {
+    // strips separated by the restart index, ready for GL_TRIANGLE_STRIP with primitive restart enabled
+    std::vector<unsigned int> indices;
+    std::size_t strip_count = 0;
+    std::size_t triangle_list_index_count = 0;
+    // fraction of the triangle list's indices saved, negative when the mesh is too disconnected for strips to pay off
+    float index_reduction = 0;
+};
+
+/**
+ * @brief converts a triangle list (the indices of any draw info class) into triangle strips joined by restart indices
+ *
+ * strips grow greedily across shared edges, starting from the triangles with the fewest neighbours so that corners
+ * and borders are not left as isolated triangles. a triangle is only appended when the strip's alternating winding
+ * reproduces its original winding, so front faces stay front faces. the triangles across each edge are found through an
+ * adjacency built once up front, so each step of a strip is constant time.
+ *
+ * @note degenerate triangles draw nothing and are dropped
+ */
+StripifyResult stripify(ArrayView<unsigned int> indices, unsigned int restart_index = primitive_restart_index);
+
+// expands strips back into a triangle list, skipping the degenerate triangles a strip may contain
+std::vector<unsigned int> unstripify(ArrayView<unsigned int> strip_indices,
+                                     unsigned int restart_index = primitive_restart_index);
+
+struct AnimationEncodingOptions {
+    // a lossless keyframe is stored every this many frames, bounding the deltas applied on a seek
+    std::size_t keyframe_interval = 30;
+    // largest error per position component (up to float rounding), deltas are quantized to steps of twice this
+    float precision = 1e-4f;
+};
+
+/**
+ * @brief vertex animation stored as keyframes plus quantized per vertex deltas, all frames share one indices array
+ *
+ * keyframes use the lossless vertex codec, other frames store each component's change from the previous frame as an
+ * 8 or 16 bit multiple of the step (whichever fits, a frame that fits neither becomes a keyframe). the encoder
+ * quantizes against its own reconstruction, so errors never exceed precision however long the delta chain is.
+ */
+struct EncodedAnimation {
+    std::vector<unsigned int> indices;
+    std::size_t vertex_count = 0;
+    std::size_t frame_count = 0;
+    float step = 0;
+    // frame f occupies data[frame_offsets[f], frame_offsets[f + 1])
+    std::vector<std::size_t> frame_offsets;
+    std::vector<unsigned char> data;
+
+    std::size_t size_in_bytes() const {
+        return indices.size() * sizeof(unsigned int) + frame_offsets.size() * sizeof(std::size_t) + data.size();
+    }
+};
+
+// throws std::runtime_error if the frames do not all share the first frame's indices and vertex count
+EncodedAnimation encode_animation(const std::vector<IndexedVertexPositions> &frames,
+                                  const AnimationEncodingOptions &options = {});
+
+/**
+ * @brief decodes frames of an EncodedAnimation into one reused positions buffer
+ *
+ * playing forward applies a single delta per frame, seeking restarts from the nearest keyframe at or before the frame.
+ *
+ * @note the animation must outlive the decoder
+ */
+class AnimationDecoder {
+  public:
+    explicit AnimationDecoder(const EncodedAnimation &animation) : animation(animation) {}
+
+    // throws std::runtime_error if frame is out of range or the data is malformed
+    const std::vector<glm::vec3> &decode_frame(std::size_t frame);
+    // copies the frame into target's positions and marks them dirty
+    void decode_frame(std::size_t frame, IndexedVertexPositions &target);
+
+  private:
+    // throws std::runtime_error unless frame_offsets[frame] < frame_offsets[frame + 1] <= data.size()
+    std::size_t frame_size(std::size_t frame) const;
+    bool is_keyframe(std::size_t frame) const;
+    void apply_frame(std::size_t frame);
+
+    const EncodedAnimation &animation;
+    std::vector<glm::vec3> xyz_positions;
+    std::vector<std::int16_t> deltas;
+    std::size_t current_frame = std::numeric_limits<std::size_t>::max();
+};
+
+} // namespace draw_info
+
 #endif // DRAW_INFO_HPP